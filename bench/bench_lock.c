@@ -0,0 +1,159 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * bench_lock.c
+ * Copyright (C) 2026 Dr.NP <np@bsgroup.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Unknown nor the name of any other
+ *    contributor may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Unknown AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Unknown OR ANY OTHER
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Spinlock benchmark : contended throughput and fairness of the ticket
+ * lock against the tiny (test-and-set) spinlock
+ *
+ * Usage : bench_lock [threads] [milliseconds]
+ *
+ * @package bsp::blacktail
+ * @author Dr.NP <np@bsgroup.org>
+ * @update 10/18/2026
+ * @changelog
+ *      [10/18/2026] - Creation
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "bsp.h"
+
+// Shared words touched inside critical section
+#define BENCH_CRITICAL_WORDS            8
+
+struct bench_lock
+{
+    const char          *name;
+    void                (*lock)(void *);
+    void                (*unlock)(void *);
+    void                *obj;
+};
+
+struct bench_arg
+{
+    struct bench_lock   *l;
+    long                acquired;
+};
+
+static volatile int stop = 0;
+static volatile uint64_t shared[BENCH_CRITICAL_WORDS];
+static BSP_TINY_SPINLOCK tiny;
+static BSP_TICKET_SPINLOCK ticket;
+
+static void _tiny_lock(void *l) { bsp_tiny_spin_lock((BSP_TINY_SPINLOCK *) l); }
+static void _tiny_unlock(void *l) { bsp_tiny_spin_unlock((BSP_TINY_SPINLOCK *) l); }
+static void _ticket_lock(void *l) { bsp_ticket_spin_lock((BSP_TICKET_SPINLOCK *) l); }
+static void _ticket_unlock(void *l) { bsp_ticket_spin_unlock((BSP_TICKET_SPINLOCK *) l); }
+
+static void * _worker(void *arg)
+{
+    struct bench_arg *a = (struct bench_arg *) arg;
+    struct bench_lock *l = a->l;
+    int i;
+    while (!stop)
+    {
+        l->lock(l->obj);
+        for (i = 0; i < BENCH_CRITICAL_WORDS; i ++)
+        {
+            shared[i] ++;
+        }
+
+        l->unlock(l->obj);
+        a->acquired ++;
+    }
+
+    return NULL;
+}
+
+static void _run(struct bench_lock *l, int nthreads, int ms)
+{
+    pthread_t tids[nthreads];
+    struct bench_arg args[nthreads];
+    long total = 0, min = -1, max = 0;
+    int i;
+
+    stop = 0;
+    for (i = 0; i < nthreads; i ++)
+    {
+        args[i].l = l;
+        args[i].acquired = 0;
+        pthread_create(&tids[i], NULL, _worker, &args[i]);
+    }
+
+    usleep(ms * 1000);
+    stop = 1;
+    for (i = 0; i < nthreads; i ++)
+    {
+        pthread_join(tids[i], NULL);
+        total += args[i].acquired;
+        min = (min < 0 || args[i].acquired < min) ? args[i].acquired : min;
+        max = (args[i].acquired > max) ? args[i].acquired : max;
+    }
+
+    // Fairness : slowest thread against fastest one, 1.00 is perfectly fair
+    printf("%-8s : %12.0f locks/s, fairness %.2f\n",
+           l->name, total * 1000.0 / ms, (max > 0) ? (double) min / max : 0.0);
+
+    return;
+}
+
+int main(int argc, char **argv)
+{
+    int nthreads = (argc > 1) ? atoi(argv[1]) : 4;
+    int ms = (argc > 2) ? atoi(argv[2]) : 1000;
+    if (nthreads < 1 || ms < 1)
+    {
+        fprintf(stderr, "Usage : %s [threads] [milliseconds]\n", argv[0]);
+
+        return 1;
+    }
+
+    struct bench_lock locks[] = {
+        {"tiny", _tiny_lock, _tiny_unlock, &tiny},
+        {"ticket", _ticket_lock, _ticket_unlock, &ticket}
+    };
+
+    int i;
+    bsp_tiny_spin_init(&tiny);
+    bsp_ticket_spin_init(&ticket);
+    printf("threads %d, %d ms per lock\n", nthreads, ms);
+    for (i = 0; i < (int) (sizeof(locks) / sizeof(locks[0])); i ++)
+    {
+        _run(&locks[i], nthreads, ms);
+    }
+
+    bsp_tiny_spin_destroy(&tiny);
+    bsp_ticket_spin_destroy(&ticket);
+
+    return 0;
+}
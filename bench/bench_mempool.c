@@ -0,0 +1,143 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * bench_mempool.c
+ * Copyright (C) 2026 Dr.NP <np@bsgroup.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Unknown nor the name of any other
+ *    contributor may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Unknown AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Unknown OR ANY OTHER
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Mempool benchmark : multi-threaded alloc / free throughput with
+ * per-thread magazines on and off
+ *
+ * Usage : bench_mempool [threads] [rounds]
+ *
+ * @package bsp::blacktail
+ * @author Dr.NP <np@bsgroup.org>
+ * @update 10/18/2026
+ * @changelog
+ *      [10/18/2026] - Creation
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "bsp.h"
+
+#define BENCH_ITEM_SIZE                 64
+#define BENCH_BATCH                     256
+
+struct bench_arg
+{
+    BSP_MEMPOOL         *pool;
+    long                rounds;
+};
+
+static double _now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void * _worker(void *arg)
+{
+    struct bench_arg *a = (struct bench_arg *) arg;
+    void *items[BENCH_BATCH];
+    long r;
+    int i;
+    for (r = 0; r < a->rounds; r ++)
+    {
+        for (i = 0; i < BENCH_BATCH; i ++)
+        {
+            items[i] = bsp_mempool_alloc(a->pool);
+        }
+
+        for (i = 0; i < BENCH_BATCH; i ++)
+        {
+            bsp_mempool_free(a->pool, items[i]);
+        }
+    }
+
+    bsp_mempool_flush_cache();
+
+    return NULL;
+}
+
+static double _run(BSP_BOOLEAN cache, int nthreads, long rounds)
+{
+    pthread_t tids[nthreads];
+    struct bench_arg a;
+    int i;
+
+    bsp_mempool_thread_cache(cache);
+    a.pool = bsp_new_mempool(BENCH_ITEM_SIZE, NULL, NULL);
+    a.rounds = rounds;
+    if (!a.pool)
+    {
+        fprintf(stderr, "Create mempool failed\n");
+        exit(1);
+    }
+
+    double start = _now();
+    for (i = 0; i < nthreads; i ++)
+    {
+        pthread_create(&tids[i], NULL, _worker, &a);
+    }
+
+    for (i = 0; i < nthreads; i ++)
+    {
+        pthread_join(tids[i], NULL);
+    }
+
+    double elapsed = _now() - start;
+    bsp_del_mempool(a.pool);
+
+    return (double) nthreads * rounds * BENCH_BATCH / elapsed;
+}
+
+int main(int argc, char **argv)
+{
+    int nthreads = (argc > 1) ? atoi(argv[1]) : 4;
+    long rounds = (argc > 2) ? atol(argv[2]) : 20000;
+    if (nthreads < 1 || rounds < 1)
+    {
+        fprintf(stderr, "Usage : %s [threads] [rounds]\n", argv[0]);
+
+        return 1;
+    }
+
+    bsp_init();
+    double off = _run(BSP_FALSE, nthreads, rounds);
+    double on = _run(BSP_TRUE, nthreads, rounds);
+    printf("threads %d, %ld alloc/free pairs per thread\n", nthreads, rounds * BENCH_BATCH);
+    printf("magazines off : %12.0f pairs/s\n", off);
+    printf("magazines on  : %12.0f pairs/s (x%.2f)\n", on, on / off);
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * bench_read.c
+ * Copyright (C) 2026 Dr.NP <np@bsgroup.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Unknown nor the name of any other
+ *    contributor may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Unknown AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Unknown OR ANY OTHER
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Buffer read benchmark : loopback TCP receive throughput of fixed 4 KiB
+ * reads against the adaptive read size of bsp_buffer_io_read_all()
+ *
+ * Usage : bench_read [megabytes] [write size]
+ *
+ * @package bsp::blacktail
+ * @author Dr.NP <np@bsgroup.org>
+ * @update 10/18/2026
+ * @changelog
+ *      [10/18/2026] - Creation
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "bsp.h"
+
+#define BENCH_FIXED_READ                4096
+// Buffer consumed each wakeup, limit keeps adaptive reads from piling up
+#define BENCH_BUFFER_LIMIT              1048576
+
+struct bench_writer
+{
+    int                 fd;
+    size_t              total;
+    size_t              chunk;
+};
+
+static double _now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void * _writer(void *arg)
+{
+    struct bench_writer *w = (struct bench_writer *) arg;
+    char *data = calloc(1, w->chunk);
+    size_t sent = 0;
+    ssize_t ret;
+    while (data && sent < w->total)
+    {
+        ret = write(w->fd, data, (w->total - sent < w->chunk) ? w->total - sent : w->chunk);
+        if (ret <= 0)
+        {
+            break;
+        }
+
+        sent += ret;
+    }
+
+    free(data);
+    close(w->fd);
+
+    return NULL;
+}
+
+// Connected loopback pair, reader side non-blocking
+static int _loopback_pair(int *rfd, int *wfd)
+{
+    struct sockaddr_in addr;
+    socklen_t alen = sizeof(addr);
+    int lfd = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (lfd < 0 ||
+        0 != bind(lfd, (struct sockaddr *) &addr, sizeof(addr)) ||
+        0 != listen(lfd, 1) ||
+        0 != getsockname(lfd, (struct sockaddr *) &addr, &alen))
+    {
+        return -1;
+    }
+
+    *wfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (*wfd < 0 || 0 != connect(*wfd, (struct sockaddr *) &addr, sizeof(addr)))
+    {
+        close(lfd);
+
+        return -1;
+    }
+
+    *rfd = accept(lfd, NULL, NULL);
+    close(lfd);
+    if (*rfd < 0)
+    {
+        return -1;
+    }
+
+    fcntl(*rfd, F_SETFL, fcntl(*rfd, F_GETFL) | O_NONBLOCK);
+
+    return 0;
+}
+
+static void _run(BSP_BOOLEAN adaptive, size_t total, size_t chunk)
+{
+    struct bench_writer w;
+    struct pollfd pfd;
+    pthread_t tid;
+    BSP_BUFFER *b = bsp_new_buffer();
+    size_t recv = 0;
+    long wakeups = 0, calls = 0;
+    ssize_t ret = 0;
+    int rfd;
+
+    if (!b || 0 != _loopback_pair(&rfd, &w.fd))
+    {
+        fprintf(stderr, "Setup loopback failed : %s\n", strerror(errno));
+        exit(1);
+    }
+
+    bsp_buffer_set_limit(b, BENCH_BUFFER_LIMIT);
+    w.total = total;
+    w.chunk = chunk;
+    pfd.fd = rfd;
+    pfd.events = POLLIN;
+    double start = _now();
+    pthread_create(&tid, NULL, _writer, &w);
+    while (recv < total)
+    {
+        if (poll(&pfd, 1, -1) <= 0)
+        {
+            continue;
+        }
+
+        wakeups ++;
+        if (adaptive)
+        {
+            ret = bsp_buffer_io_read_all(b, rfd);
+            calls ++;
+            if (ret > 0)
+            {
+                recv += ret;
+            }
+        }
+        else
+        {
+            // Fixed size reads until drained
+            while ((ret = bsp_buffer_io_read(b, rfd, BENCH_FIXED_READ)) > 0)
+            {
+                recv += ret;
+                calls ++;
+                bsp_clear_buffer(b);
+            }
+
+            calls ++;
+        }
+
+        bsp_clear_buffer(b);
+        if (0 == ret || (ret < 0 && EAGAIN != errno && EWOULDBLOCK != errno))
+        {
+            break;
+        }
+    }
+
+    double elapsed = _now() - start;
+    pthread_join(tid, NULL);
+    printf("%-8s : %10.1f MB/s, %ld wakeups, %ld calls\n",
+           adaptive ? "adaptive" : "fixed", recv / elapsed / 1048576.0, wakeups, calls);
+    close(rfd);
+    bsp_del_buffer(b);
+
+    return;
+}
+
+int main(int argc, char **argv)
+{
+    size_t mb = (argc > 1) ? (size_t) atol(argv[1]) : 512;
+    size_t chunk = (argc > 2) ? (size_t) atol(argv[2]) : 65536;
+    if (mb < 1 || chunk < 1)
+    {
+        fprintf(stderr, "Usage : %s [megabytes] [write size]\n", argv[0]);
+
+        return 1;
+    }
+
+    bsp_init();
+    printf("%zu MB over loopback, %zu bytes per write\n", mb, chunk);
+    _run(BSP_FALSE, mb * 1048576, chunk);
+    _run(BSP_TRUE, mb * 1048576, chunk);
+
+    return 0;
+}
@@ -51,23 +51,50 @@
 // Values
 #define _BSP_MAX_OPEN_FILES             1048576
 #define _BSP_SAFE_OPEN_FILES            1024
+#define _BSP_FD_SEGMENT_BITS            8
+#define _BSP_FD_SEGMENT_SIZE            (1 << _BSP_FD_SEGMENT_BITS)
 #define _BSP_TCP_BACKLOG                511
 #define _BSP_UDP_MAX_SNDBUF             1048576
 #define _BSP_UDP_MAX_RCVBUF             1048576
+#define _BSP_SEND_IOV_MAX               64
+#define _BSP_SEND_FILE_CHUNK            16384
+#define _BSP_UDP_BATCH                  64
+#define _BSP_UDP_SLOT_SIZE              65536
+#define _BSP_UDP_GSO_SEGMENTS           64
+#define _BSP_UDP_GSO_BYTES              65000
 #define _BSP_MAX_UNSIZED_STRLEN         4096
 #define _BSP_MEMPOOL_FREE_LIST_SIZE     256
+#define _BSP_MEMPOOL_MAX_CACHED         64
+#define _BSP_MEMPOOL_SLAB_SIZE          65536
+#define _BSP_MEMPOOL_HUGE_SLAB_SIZE     2097152
+#define _BSP_MEMPOOL_SLAB_ITEM_MAX      4096
+#define _BSP_MEMPOOL_LOW_WATER          256
+#define _BSP_MEMPOOL_TRIM_INTERVAL      10
 #define _BSP_BUFFER_HIGHWATER           524288
 #define _BSP_BUFFER_UNSATURATION        131072
+#define _BSP_BUFFER_CACHE_MIN_SHIFT     12
+#define _BSP_BUFFER_CACHE_CLASSES       7
+#define _BSP_BUFFER_CACHE_DEPTH         16
+#define _BSP_BUFFER_CACHE_BYTES         4194304
+#define _BSP_SOCKET_READ_BUFFER_LIMIT   1048576
+#define _BSP_SOCKET_ACCEPT_BUDGET       128
+#define _BSP_SOCKET_ACCEPT_BATCH        32
 #define _BSP_MAX_TRACE_LENGTH           4096
+#define _BSP_LOCK_PROFILE_SLOTS         1024
+#define _BSP_LOCK_PROFILE_NAMES         256
+#define _BSP_LOCK_NAME_LENGTH           48
 #define _BSP_THREAD_LIST_INITIAL        128
 #define _BSP_ARRAY_BUCKET_SIZE          64
 #define _BSP_HASH_SIZE_INITIAL          8
 #define _BSP_FD_READ_ONCE               4096
+#define _BSP_FD_READ_MIN                1024
+#define _BSP_FD_READ_MAX                65536
 #define _BSP_MAX_SESSION_ID_LENGTH      128
 
 // This value is ignored since Linux 2.6.8
 #define _BSP_EPOLL_SIZE                 1024
 #define _BSP_EVENT_QUEUE_LENGTH         1024
+#define _BSP_EVENT_CHANGE_LIST_INITIAL  256
 
 /**
  * Private functions
@@ -0,0 +1,202 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * bsp_arena.c
+ * Copyright (C) 2015 Dr.NP <np@bsgroup.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Unknown nor the name of any other
+ *    contributor may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Unknown AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Unknown OR ANY OTHER
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Request-scoped bump-pointer arena
+ *
+ * @package bsp::blacktail
+ * @author Dr.NP <np@bsgroup.org>
+ * @update 10/18/2026
+ * @changelog
+ *      [10/18/2026] - Creation
+ */
+
+#include "bsp-private.h"
+#include "bsp.h"
+
+BSP_PRIVATE(const char *) _tag_ = "Arena";
+
+#define _ALIGN_UP(n)                    (((n) + BSP_ARENA_ALIGN - 1) & ~((size_t) BSP_ARENA_ALIGN - 1))
+#define _CHUNK_HEADER                   _ALIGN_UP(sizeof(BSP_ARENA_CHUNK))
+
+BSP_PRIVATE(BSP_ARENA_CHUNK *) _new_chunk(size_t size)
+{
+    BSP_ARENA_CHUNK *c = bsp_malloc(_CHUNK_HEADER + size);
+    if (!c)
+    {
+        bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Arena chunk alloc failed");
+
+        return NULL;
+    }
+
+    c->next = NULL;
+    c->size = size;
+    c->used = 0;
+    c->data = (char *) c + _CHUNK_HEADER;
+
+    return c;
+}
+
+// Generate a new arena
+BSP_DECLARE(BSP_ARENA *) bsp_new_arena(size_t chunk_size)
+{
+    BSP_ARENA *a = bsp_calloc(1, sizeof(BSP_ARENA));
+    if (!a)
+    {
+        bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Arena alloc failed");
+
+        return NULL;
+    }
+
+    a->chunk_size = (chunk_size > 0) ? _ALIGN_UP(chunk_size) : BSP_ARENA_CHUNK_SIZE;
+    a->head = _new_chunk(a->chunk_size);
+    if (!a->head)
+    {
+        bsp_free(a);
+
+        return NULL;
+    }
+
+    a->curr = a->head;
+
+    return a;
+}
+
+// Delete an arena
+BSP_DECLARE(void) bsp_del_arena(BSP_ARENA *a)
+{
+    BSP_ARENA_CHUNK *c, *next;
+    if (a)
+    {
+        bsp_reset_arena(a);
+        c = a->head;
+        while (c)
+        {
+            next = c->next;
+            bsp_free(c);
+            c = next;
+        }
+
+        bsp_free(a);
+    }
+
+    return;
+}
+
+// Alloc from arena
+BSP_DECLARE(void *) bsp_arena_alloc(BSP_ARENA *a, size_t size)
+{
+    if (!a)
+    {
+        return NULL;
+    }
+
+    BSP_ARENA_CHUNK *c = a->curr;
+    size = _ALIGN_UP(size ? size : 1);
+    if (size > a->chunk_size / 4)
+    {
+        // Oversized, standalone block
+        c = _new_chunk(size);
+        if (!c)
+        {
+            return NULL;
+        }
+
+        c->next = a->large;
+        a->large = c;
+        a->allocated += size;
+
+        return c->data;
+    }
+
+    if (c->used + size > c->size)
+    {
+        // Move to next chunk, kept from earlier rounds or new one
+        if (!c->next)
+        {
+            c->next = _new_chunk(a->chunk_size);
+            if (!c->next)
+            {
+                return NULL;
+            }
+        }
+
+        c = c->next;
+        c->used = 0;
+        a->curr = c;
+    }
+
+    void *ret = c->data + c->used;
+    c->used += size;
+    a->allocated += size;
+
+    return ret;
+}
+
+// Alloc zeroed memory from arena
+BSP_DECLARE(void *) bsp_arena_calloc(BSP_ARENA *a, size_t nmemb, size_t size)
+{
+    if (size && nmemb > SIZE_MAX / size)
+    {
+        return NULL;
+    }
+
+    void *ret = bsp_arena_alloc(a, nmemb * size);
+    if (ret)
+    {
+        memset(ret, 0, nmemb * size);
+    }
+
+    return ret;
+}
+
+// Reset arena
+BSP_DECLARE(void) bsp_reset_arena(BSP_ARENA *a)
+{
+    BSP_ARENA_CHUNK *c, *next;
+    if (a)
+    {
+        c = a->large;
+        while (c)
+        {
+            next = c->next;
+            bsp_free(c);
+            c = next;
+        }
+
+        // Chunks after head reset lazily when reached again
+        a->large = NULL;
+        a->head->used = 0;
+        a->curr = a->head;
+        a->allocated = 0;
+    }
+
+    return;
+}
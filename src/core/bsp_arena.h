@@ -0,0 +1,122 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * bsp_arena.h
+ * Copyright (C) 2015 Dr.NP <np@bsgroup.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Unknown nor the name of any other
+ *    contributor may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Unknown AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Unknown OR ANY OTHER
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Request-scoped bump-pointer arena header
+ *
+ * @package bsp::blacktail
+ * @author Dr.NP <np@bsgroup.org>
+ * @update 10/18/2026
+ * @changelog
+ *      [10/18/2026] - Creation
+ */
+
+#ifndef _CORE_BSP_ARENA_H
+
+#define _CORE_BSP_ARENA_H
+/* Headers */
+
+/* Definations */
+#define BSP_ARENA_ALIGN                 16
+#define BSP_ARENA_CHUNK_SIZE            65536
+
+/* Macros */
+
+/* Structs */
+typedef struct bsp_arena_chunk_t
+{
+    struct bsp_arena_chunk_t
+                        *next;
+    size_t              size;
+    size_t              used;
+    char                *data;
+} BSP_ARENA_CHUNK;
+
+typedef struct bsp_arena_t
+{
+    BSP_ARENA_CHUNK     *head;
+    BSP_ARENA_CHUNK     *curr;
+    BSP_ARENA_CHUNK     *large;
+    size_t              chunk_size;
+    size_t              allocated;
+} BSP_ARENA;
+
+/* Functions */
+/**
+ * Generate a new arena. Arena is not thread-safe, each thread should use its own
+ *
+ * @param size_t chunk_size Size of each chunk, 0 for BSP_ARENA_CHUNK_SIZE
+ *
+ * @return p BSP_ARENA
+ */
+BSP_DECLARE(BSP_ARENA *) bsp_new_arena(size_t chunk_size);
+
+/**
+ * Delete an arena and all memory in it
+ *
+ * @param BSP_ARENA a Arena
+ *
+ * @return void
+ */
+BSP_DECLARE(void) bsp_del_arena(BSP_ARENA *a);
+
+/**
+ * Alloc memory from arena, aligned to BSP_ARENA_ALIGN.
+ * Memory is never freed one by one, only by bsp_reset_arena()
+ *
+ * @param BSP_ARENA a Arena
+ * @param size_t size Length
+ *
+ * @return p void
+ */
+BSP_DECLARE(void *) bsp_arena_alloc(BSP_ARENA *a, size_t size);
+
+/**
+ * Alloc zeroed memory from arena
+ *
+ * @param BSP_ARENA a Arena
+ * @param size_t nmemb Number of members
+ * @param size_t size Length of each member
+ *
+ * @return p void
+ */
+BSP_DECLARE(void *) bsp_arena_calloc(BSP_ARENA *a, size_t nmemb, size_t size);
+
+/**
+ * Release everything allocated from arena at once.
+ * Chunks are kept for reuse, oversized blocks returned to system
+ *
+ * @param BSP_ARENA a Arena
+ *
+ * @return void
+ */
+BSP_DECLARE(void) bsp_reset_arena(BSP_ARENA *a);
+
+#endif  /* _CORE_BSP_ARENA_H */
@@ -46,6 +46,14 @@ BSP_PRIVATE(const char *) _tag_ = "BootStrap";
 BSP_PRIVATE(BSP_BOOTSTRAP_OPTIONS) options;
 BSP_PRIVATE(BSP_THREAD *) boss = NULL;
 
+// Idle-time mempool trimming
+BSP_PRIVATE(void) _trim_mempools(BSP_TIMER *tmr)
+{
+    bsp_mempool_trim_all();
+
+    return;
+}
+
 // Signal handlers
 BSP_PRIVATE(void) _exit_handler(const int sig)
 {
@@ -74,6 +82,9 @@ BSP_PRIVATE(void) _tstp_handler(const int sig)
 
 BSP_PRIVATE(void) _usr1_handler(const int sig)
 {
+#ifdef ENABLE_LOCK_PROFILE
+    bsp_lock_profile_dump();
+#endif
     if (options.signal_on_usr1)
     {
         options.signal_on_usr1();
@@ -295,6 +306,16 @@ BSP_DECLARE(int) bsp_prepare(BSP_BOOTSTRAP_OPTIONS *o)
                        options.boss_hook_timer, 
                        options.boss_hook_notify);
 
+    if (boss)
+    {
+        struct timespec trim = {_BSP_MEMPOOL_TRIM_INTERVAL, 0};
+        BSP_TIMER *tmr = bsp_new_timer(boss->event_container, &trim, &trim, -1);
+        if (tmr)
+        {
+            tmr->on_timer = _trim_mempools;
+        }
+    }
+
     return BSP_RTN_SUCCESS;
 }
 
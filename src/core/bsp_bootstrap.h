@@ -65,7 +65,7 @@ typedef struct bsp_bootstrap_options_t
     int                 boss_threads;
 
     // Number of acceptor threads
-    // Always 1 at this time...
+    // Always 1 at this time, servers from bsp_new_reuseport_server() accept in IO threads instead
     int                 acceptor_threads;
 
     // Number of NIO threads.
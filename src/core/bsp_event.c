@@ -30,7 +30,7 @@
 
 /**
  * Event implementations
- * Epoll (Linux 2.6+) & KQueue (BSD)
+ * IO_uring (Linux 5.11+), Epoll (Linux 2.6+) & KQueue (BSD)
  *
  * @package bsp::blacktail
  * @author Dr.NP <np@bsgroup.org>
@@ -60,7 +60,991 @@ BSP_PRIVATE(BSP_EVENT_DATA *) _get_event_data(int fd)
 }
 */
 
-#if defined(EVENT_USE_EPOLL)
+#if defined(EVENT_USE_IO_URING) || defined(EVENT_USE_EPOLL)
+#include <poll.h>
+// Whether current thread runs the loop of container
+BSP_PRIVATE(inline BSP_BOOLEAN) _container_is_owner(BSP_EVENT_CONTAINER *ec)
+{
+    BSP_THREAD *t = bsp_self_thread();
+
+    return (t && t->event_container == ec) ? BSP_TRUE : BSP_FALSE;
+}
+
+// Wakeup state of container
+#define _WAKE_SLEEPING                  0x1
+#define _WAKE_PENDING                   0x2
+
+// Mark container sleeping before wait, returns BSP_FALSE if a poke is pending (Do not block)
+BSP_PRIVATE(inline BSP_BOOLEAN) _wake_prepare_sleep(BSP_EVENT_CONTAINER *ec)
+{
+    int old = __atomic_fetch_or(&ec->wake_state, _WAKE_SLEEPING, __ATOMIC_SEQ_CST);
+
+    return (old & _WAKE_PENDING) ? BSP_FALSE : BSP_TRUE;
+}
+
+// Mark container awake after wait, returns BSP_TRUE if a poke consumed
+BSP_PRIVATE(inline BSP_BOOLEAN) _wake_finish_sleep(BSP_EVENT_CONTAINER *ec)
+{
+    int old = __atomic_exchange_n(&ec->wake_state, 0, __ATOMIC_SEQ_CST);
+
+    return (old & _WAKE_PENDING) ? BSP_TRUE : BSP_FALSE;
+}
+
+// Append notification of consumed poke into active list
+BSP_PRIVATE(int) _wake_notify(BSP_EVENT_CONTAINER *ec, int total)
+{
+    BSP_FD *f = bsp_get_fd(ec->notify_fd, BSP_FD_EVENT);
+    if (!f)
+    {
+        return total;
+    }
+
+    if (total >= BSP_EVENT_QUEUE_LENGTH)
+    {
+        // List full, leave it to next wait
+        __atomic_fetch_or(&ec->wake_state, _WAKE_PENDING, __ATOMIC_SEQ_CST);
+
+        return total;
+    }
+
+    f->event.triggered = BSP_EVENT_EVENT;
+    ec->active_fds[total ++] = f;
+
+    return total;
+}
+
+// Decode poll-style events into triggered mask of fd
+// POLL* and EPOLL* share the same bits on Linux, so both backends use this
+BSP_PRIVATE(int) _decode_events(BSP_FD *f, uint32_t revents)
+{
+    uint64_t notify_data = 0;
+    ssize_t ret = 0;
+    int triggered = 0;
+    if (revents & POLLIN)
+    {
+        switch (f->type)
+        {
+            case BSP_FD_SIGNAL : 
+                triggered |= BSP_EVENT_SIGNAL;
+                break;
+            case BSP_FD_TIMER : 
+                ret = read(f->fd, (void *) &notify_data, 8);
+                if (8 == ret)
+                {
+                    triggered |= BSP_EVENT_TIMER;
+                }
+
+                break;
+            case BSP_FD_EVENT : 
+                ret = read(f->fd, (void *) &notify_data, 8);
+                if (8 == ret)
+                {
+                    triggered |= BSP_EVENT_EVENT;
+                }
+
+                break;
+            case BSP_FD_SOCKET_SERVER_TCP : 
+            case BSP_FD_SOCKET_SERVER_SCTP : 
+                triggered |= BSP_EVENT_ACCEPT;
+                break;
+            case BSP_FD_GENERAL : 
+            case BSP_FD_PIPE : 
+            case BSP_FD_SOCKET_SERVER_UDP : 
+            case BSP_FD_SOCKET_CLIENT_TCP : 
+            case BSP_FD_SOCKET_CLIENT_SCTP : 
+            case BSP_FD_SOCKET_CONNECTOR_TCP : 
+            case BSP_FD_SOCKET_CONNECTOR_SCTP : 
+                triggered |= BSP_EVENT_READ;
+                break;
+            default : 
+                // Do nothing
+                break;
+        }
+    }
+
+    if (revents & POLLOUT)
+    {
+        switch (f->type)
+        {
+            case BSP_FD_GENERAL : 
+            case BSP_FD_SOCKET_CLIENT_TCP : 
+            case BSP_FD_SOCKET_CLIENT_SCTP : 
+            case BSP_FD_SOCKET_CLIENT_LOCAL : 
+            case BSP_FD_SOCKET_CONNECTOR_TCP : 
+            case BSP_FD_SOCKET_CONNECTOR_UDP : 
+            case BSP_FD_SOCKET_CONNECTOR_SCTP : 
+            case BSP_FD_SOCKET_CONNECTOR_LOCAL : 
+            case BSP_FD_SOCKET_SERVER_UDP : 
+                triggered |= BSP_EVENT_WRITE;
+                break;
+            default : 
+                // Do nothing
+                break;
+        }
+    }
+
+    if (revents & POLLHUP)
+    {
+        switch (f->type)
+        {
+            case BSP_FD_SOCKET_CLIENT_TCP : 
+            case BSP_FD_SOCKET_CLIENT_SCTP : 
+            case BSP_FD_SOCKET_CLIENT_LOCAL : 
+            case BSP_FD_SOCKET_CONNECTOR_TCP : 
+            case BSP_FD_SOCKET_CONNECTOR_SCTP : 
+            case BSP_FD_SOCKET_CONNECTOR_LOCAL : 
+                triggered |= BSP_EVENT_LOCAL_HUP;
+                break;
+            default : 
+                // Do nothing
+                break;
+        }
+    }
+
+#ifdef POLLRDHUP
+    if (revents & POLLRDHUP)
+    {
+        switch (f->type)
+        {
+            case BSP_FD_SOCKET_CLIENT_TCP : 
+            case BSP_FD_SOCKET_CLIENT_SCTP : 
+            case BSP_FD_SOCKET_CLIENT_LOCAL : 
+            case BSP_FD_SOCKET_CONNECTOR_TCP : 
+            case BSP_FD_SOCKET_CONNECTOR_SCTP : 
+            case BSP_FD_SOCKET_CONNECTOR_LOCAL : 
+                triggered |= BSP_EVENT_REMOTE_HUP;
+                break;
+            default : 
+                // Do nothing
+                break;
+        }
+    }
+
+#endif
+    if (revents & POLLERR)
+    {
+        triggered |= BSP_EVENT_ERROR;
+    }
+
+    return triggered;
+}
+#endif
+
+#if defined(EVENT_USE_IO_URING)
+// {{{ IO_uring implementation
+#include <sys/syscall.h>
+
+#define _URING_OP_POLL                  0x1
+#define _URING_OP_READ                  0x2
+#define _URING_OP_WRITE                 0x3
+#define _URING_OP_ACCEPT                0x4
+#define _URING_OP_CANCEL                0xF
+
+// User data of SQE : [op:8][serial:24][fd:32]
+// Serial of poll request is the arm serial of fd, serial of completion-style IO is the generation of fd,
+// so re-arming a poll never invalidates IO in flight
+#define _URING_DATA(op, serial, fd)     (((uint64_t) (op) << 56) | (((uint64_t) (serial) & 0xFFFFFF) << 32) | (uint32_t) (fd))
+#define _URING_DATA_OP(data)            ((int) ((data) >> 56))
+#define _URING_DATA_SERIAL(data)        ((uint32_t) (((data) >> 32) & 0xFFFFFF))
+#define _URING_DATA_FD(data)            ((int) ((data) & 0xFFFFFFFF))
+
+BSP_PRIVATE(inline int) _uring_setup(unsigned int entries, struct io_uring_params *p)
+{
+    return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+BSP_PRIVATE(inline int) _uring_enter(int ring_fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags)
+{
+    return (int) syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+// Submit and wait for at least one completion, with timeout in milliseconds (Negative for infinite)
+BSP_PRIVATE(int) _uring_enter_wait(int ring_fd, unsigned int to_submit, int timeout)
+{
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    if (timeout < 0)
+    {
+        return _uring_enter(ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS);
+    }
+
+    bzero(&arg, sizeof(struct io_uring_getevents_arg));
+    ts.tv_sec = timeout / 1000;
+    ts.tv_nsec = (long long) (timeout % 1000) * 1000000;
+    arg.ts = (uint64_t) (uintptr_t) &ts;
+
+    return (int) syscall(__NR_io_uring_enter, ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(struct io_uring_getevents_arg));
+}
+
+// Next arm serial of container (never be zero). sq_lock must be held
+BSP_PRIVATE(inline uint32_t) _uring_next_serial(BSP_EVENT_CONTAINER *ec)
+{
+    ec->serial = (ec->serial + 1) & 0xFFFFFF;
+    if (0 == ec->serial)
+    {
+        ec->serial = 1;
+    }
+
+    return ec->serial;
+}
+
+// Fetch an empty SQE from ring. sq_lock must be held
+BSP_PRIVATE(struct io_uring_sqe *) _uring_get_sqe(BSP_EVENT_CONTAINER *ec)
+{
+    unsigned int head = __atomic_load_n(ec->sq_head, __ATOMIC_ACQUIRE);
+    unsigned int tail = *ec->sq_tail;
+    int ret;
+    if (tail - head >= ec->sq_entries)
+    {
+        // Ring full, flush it to kernel first
+        ret = _uring_enter(ec->ring_fd, ec->sq_pending, 0, 0);
+        if (ret > 0)
+        {
+            ec->sq_pending -= ret;
+        }
+
+        head = __atomic_load_n(ec->sq_head, __ATOMIC_ACQUIRE);
+        if (tail - head >= ec->sq_entries)
+        {
+            bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Submission queue of container %d full", ec->ring_fd);
+
+            return NULL;
+        }
+    }
+
+    unsigned int idx = tail & *ec->sq_mask;
+    struct io_uring_sqe *sqe = &ec->sqes[idx];
+    bzero(sqe, sizeof(struct io_uring_sqe));
+    ec->sq_array[idx] = idx;
+
+    return sqe;
+}
+
+// Publish the SQE fetched by _uring_get_sqe(). sq_lock must be held
+BSP_PRIVATE(inline void) _uring_push_sqe(BSP_EVENT_CONTAINER *ec)
+{
+    __atomic_store_n(ec->sq_tail, *ec->sq_tail + 1, __ATOMIC_RELEASE);
+    ec->sq_pending ++;
+
+    return;
+}
+
+// Submit all pending SQEs without waiting
+BSP_PRIVATE(int) _uring_submit(BSP_EVENT_CONTAINER *ec)
+{
+    int ret = 0;
+    bsp_spin_lock(&ec->sq_lock);
+    if (ec->sq_pending > 0)
+    {
+        ret = _uring_enter(ec->ring_fd, ec->sq_pending, 0, 0);
+        if (ret > 0)
+        {
+            ec->sq_pending -= ret;
+        }
+    }
+
+    bsp_spin_unlock(&ec->sq_lock);
+
+    return ret;
+}
+
+// Poll mask of fd
+BSP_PRIVATE(uint32_t) _uring_poll_mask(BSP_FD *f)
+{
+    BSP_EVENT_SPEC *ev = FD_EVENT(f);
+    uint32_t mask = 0;
+    if (BSP_FD_TIMER == f->type)
+    {
+        return POLLIN;
+    }
+
+#ifdef POLLRDHUP
+    mask |= POLLRDHUP;
+#endif
+    if (ev->events & BSP_EVENT_READ || ev->events & BSP_EVENT_ACCEPT || ev->events & BSP_EVENT_EVENT || ev->events & BSP_EVENT_SIGNAL)
+    {
+        mask |= POLLIN;
+    }
+
+    if (ev->events & BSP_EVENT_WRITE)
+    {
+        mask |= POLLOUT;
+    }
+
+    return mask;
+}
+
+// Queue a poll request of given mask with current serial of fd. sq_lock must be held
+BSP_PRIVATE(int) _uring_queue_poll(BSP_EVENT_CONTAINER *ec, BSP_FD *f, uint32_t mask)
+{
+    BSP_EVENT_SPEC *ev = FD_EVENT(f);
+    struct io_uring_sqe *sqe = _uring_get_sqe(ec);
+    if (!sqe)
+    {
+        return BSP_RTN_ERR_EVENT_URING;
+    }
+
+    ev->registered = mask;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = f->fd;
+    sqe->poll32_events = ev->registered;
+    sqe->user_data = _URING_DATA(_URING_OP_POLL, ev->serial, f->fd);
+    _uring_push_sqe(ec);
+
+    return BSP_RTN_SUCCESS;
+}
+
+// Queue a poll removal of fd's current serial. sq_lock must be held
+BSP_PRIVATE(int) _uring_queue_remove(BSP_EVENT_CONTAINER *ec, BSP_FD *f)
+{
+    BSP_EVENT_SPEC *ev = FD_EVENT(f);
+    struct io_uring_sqe *sqe = _uring_get_sqe(ec);
+    if (!sqe)
+    {
+        return BSP_RTN_ERR_EVENT_URING;
+    }
+
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = _URING_DATA(_URING_OP_POLL, ev->serial, f->fd);
+    sqe->user_data = _URING_DATA(_URING_OP_CANCEL, 0, f->fd);
+    _uring_push_sqe(ec);
+
+    return BSP_RTN_SUCCESS;
+}
+
+// Cancel all completion-style IO of fd still in flight. sq_lock must be held
+BSP_PRIVATE(int) _uring_queue_cancel_io(BSP_EVENT_CONTAINER *ec, BSP_FD *f)
+{
+    struct io_uring_sqe *sqe;
+#ifdef IORING_ASYNC_CANCEL_FD
+    sqe = _uring_get_sqe(ec);
+    if (!sqe)
+    {
+        return BSP_RTN_ERR_EVENT_URING;
+    }
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = f->fd;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = _URING_DATA(_URING_OP_CANCEL, 0, f->fd);
+    _uring_push_sqe(ec);
+#else
+    // Old kernel headers : cancel by user data, one request of each kind
+    static const int ops[] = {_URING_OP_READ, _URING_OP_WRITE, _URING_OP_ACCEPT};
+    size_t i;
+    for (i = 0; i < sizeof(ops) / sizeof(int); i ++)
+    {
+        sqe = _uring_get_sqe(ec);
+        if (!sqe)
+        {
+            return BSP_RTN_ERR_EVENT_URING;
+        }
+
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = _URING_DATA(ops[i], f->gen, f->fd);
+        sqe->user_data = _URING_DATA(_URING_OP_CANCEL, 0, f->fd);
+        _uring_push_sqe(ec);
+    }
+#endif
+
+    return BSP_RTN_SUCCESS;
+}
+
+// Queue a completion-style IO request
+BSP_PRIVATE(int) _uring_queue_io(BSP_FD *f, int op, void *addr, size_t len, void *addr2)
+{
+    BSP_EVENT_SPEC *ev = FD_EVENT(f);
+    BSP_EVENT_CONTAINER *ec = ev->container;
+    if (!ec)
+    {
+        return BSP_RTN_INVALID;
+    }
+
+    bsp_spin_lock(&ec->sq_lock);
+    struct io_uring_sqe *sqe = _uring_get_sqe(ec);
+    if (!sqe)
+    {
+        bsp_spin_unlock(&ec->sq_lock);
+
+        return BSP_RTN_ERR_EVENT_URING;
+    }
+
+    switch (op)
+    {
+        case _URING_OP_READ : 
+            sqe->opcode = IORING_OP_READ;
+            sqe->off = (uint64_t) -1;
+            break;
+        case _URING_OP_WRITE : 
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->off = (uint64_t) -1;
+            break;
+        case _URING_OP_ACCEPT : 
+        default : 
+            sqe->opcode = IORING_OP_ACCEPT;
+            sqe->addr2 = (uint64_t) (uintptr_t) addr2;
+            sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+            break;
+    }
+
+    sqe->fd = f->fd;
+    sqe->addr = (uint64_t) (uintptr_t) addr;
+    sqe->len = (uint32_t) len;
+    sqe->user_data = _URING_DATA(op, f->gen, f->fd);
+    _uring_push_sqe(ec);
+    ev->io_queued = BSP_TRUE;
+    bsp_spin_unlock(&ec->sq_lock);
+
+    // Owner thread submits in batch before next wait
+    if (BSP_TRUE != _container_is_owner(ec))
+    {
+        _uring_submit(ec);
+    }
+
+    return BSP_RTN_SUCCESS;
+}
+
+// Unmap rings of container
+BSP_PRIVATE(void) _uring_unmap(BSP_EVENT_CONTAINER *ec)
+{
+    if (ec->sqes && MAP_FAILED != (void *) ec->sqes)
+    {
+        munmap(ec->sqes, ec->sqes_size);
+    }
+
+    if (ec->cq_ring && MAP_FAILED != ec->cq_ring && ec->cq_ring != ec->sq_ring)
+    {
+        munmap(ec->cq_ring, ec->cq_ring_size);
+    }
+
+    if (ec->sq_ring && MAP_FAILED != ec->sq_ring)
+    {
+        munmap(ec->sq_ring, ec->sq_ring_size);
+    }
+
+    return;
+}
+
+// Create a new kernel event container
+BSP_DECLARE(BSP_EVENT_CONTAINER *) bsp_new_event_container()
+{
+    BSP_EVENT_CONTAINER *ec = bsp_calloc(1, sizeof(BSP_EVENT_CONTAINER));
+    if (!ec)
+    {
+        bsp_trace_message(BSP_TRACE_EMERGENCY, _tag_, "Create event container failed");
+
+        return NULL;
+    }
+
+    struct io_uring_params p;
+    bzero(&p, sizeof(struct io_uring_params));
+    int ring_fd = _uring_setup(BSP_EVENT_QUEUE_LENGTH, &p);
+    if (0 > ring_fd)
+    {
+        switch (errno)
+        {
+            case ENOSYS : 
+                bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "IO_uring not supported by kernel");
+                break;
+            case EPERM : 
+                bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "IO_uring disabled by system");
+                break;
+            case ENFILE : 
+            case EMFILE : 
+                bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Cannot open another file descriptor");
+                break;
+            case ENOMEM : 
+                bsp_trace_message(BSP_TRACE_EMERGENCY, _tag_, "Kernel memory full");
+                break;
+            default : 
+                bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Cannot create event container");
+                break;
+        }
+
+        bsp_free(ec);
+
+        return NULL;
+    }
+
+    if (!(p.features & IORING_FEAT_EXT_ARG))
+    {
+        // Timeout of wait required by timers
+        bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "IO_uring of kernel 5.11+ required");
+        close(ring_fd);
+        bsp_free(ec);
+
+        return NULL;
+    }
+
+    ec->ring_fd = ring_fd;
+    ec->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+    ec->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    ec->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        // SQ and CQ rings share one mapping
+        if (ec->cq_ring_size > ec->sq_ring_size)
+        {
+            ec->sq_ring_size = ec->cq_ring_size;
+        }
+
+        ec->cq_ring_size = ec->sq_ring_size;
+    }
+
+    ec->sq_ring = mmap(NULL, ec->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        ec->cq_ring = ec->sq_ring;
+    }
+    else
+    {
+        ec->cq_ring = mmap(NULL, ec->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+    }
+
+    ec->sqes = mmap(NULL, ec->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (MAP_FAILED == ec->sq_ring || MAP_FAILED == ec->cq_ring || MAP_FAILED == (void *) ec->sqes)
+    {
+        bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Map rings of event container failed");
+        _uring_unmap(ec);
+        close(ring_fd);
+        bsp_free(ec);
+
+        return NULL;
+    }
+
+    ec->sq_head = (unsigned int *) ((char *) ec->sq_ring + p.sq_off.head);
+    ec->sq_tail = (unsigned int *) ((char *) ec->sq_ring + p.sq_off.tail);
+    ec->sq_mask = (unsigned int *) ((char *) ec->sq_ring + p.sq_off.ring_mask);
+    ec->sq_array = (unsigned int *) ((char *) ec->sq_ring + p.sq_off.array);
+    ec->sq_entries = p.sq_entries;
+    ec->cq_head = (unsigned int *) ((char *) ec->cq_ring + p.cq_off.head);
+    ec->cq_tail = (unsigned int *) ((char *) ec->cq_ring + p.cq_off.tail);
+    ec->cq_mask = (unsigned int *) ((char *) ec->cq_ring + p.cq_off.ring_mask);
+    ec->cqes = (struct io_uring_cqe *) ((char *) ec->cq_ring + p.cq_off.cqes);
+    bsp_spin_init(&ec->sq_lock);
+    bsp_trace_message(BSP_TRACE_INFORMATIONAL, _tag_, "Create new event container %d with IO_uring", ring_fd);
+
+    // Create event fd
+    ec->notify_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (ec->notify_fd < 0)
+    {
+        _uring_unmap(ec);
+        close(ring_fd);
+        bsp_free(ec);
+
+        return NULL;
+    }
+
+    BSP_FD *f = bsp_reg_fd(ec->notify_fd, BSP_FD_EVENT, NULL);
+    if (!f)
+    {
+        close(ec->notify_fd);
+        _uring_unmap(ec);
+        close(ring_fd);
+        bsp_free(ec);
+
+        return NULL;
+    }
+
+    BSP_EVENT_SPEC *ev = FD_EVENT(f);
+    ev->events = BSP_EVENT_EVENT;
+    ev->container = ec;
+    bsp_set_event(ec->notify_fd);
+    bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Create notification event of container %d", ring_fd);
+
+    return ec;
+}
+
+// Close event container
+BSP_DECLARE(int) bsp_del_event_container(BSP_EVENT_CONTAINER *ec)
+{
+    if (ec)
+    {
+        _uring_unmap(ec);
+        close(ec->ring_fd);
+        bsp_del_timer_wheel(ec->timer_wheel);
+        bsp_free(ec);
+        bsp_trace_message(BSP_TRACE_WARNING, _tag_, "Event container closed, BSP_EVENT_DATA leak should be occured");
+
+        return BSP_RTN_SUCCESS;
+    }
+
+    return BSP_RTN_INVALID;
+}
+
+// Queue poll request of fd with its current mask. sq_lock must be held
+BSP_PRIVATE(int) _uring_arm(BSP_EVENT_CONTAINER *ec, BSP_FD *f)
+{
+    BSP_EVENT_SPEC *ev = FD_EVENT(f);
+    uint32_t mask = _uring_poll_mask(f);
+    int ret = BSP_RTN_SUCCESS;
+    if (ev->registered == mask)
+    {
+        // Armed with same mask already
+        return BSP_RTN_SUCCESS;
+    }
+
+    if (ev->registered)
+    {
+        // Cancel the poll in flight
+        ret = _uring_queue_remove(ec, f);
+    }
+
+    if (BSP_RTN_SUCCESS == ret)
+    {
+        ev->serial = _uring_next_serial(ec);
+        ret = _uring_queue_poll(ec, f, mask);
+    }
+
+    return ret;
+}
+
+// Arm (or re-arm with new mask) a poll request of fd
+BSP_DECLARE(int) bsp_set_event(int fd)
+{
+    BSP_FD *f = bsp_get_fd(fd, BSP_FD_ANY);
+    if (!f)
+    {
+        return BSP_RTN_INVALID;
+    }
+
+    BSP_EVENT_SPEC *ev = FD_EVENT(f);
+    BSP_EVENT_CONTAINER *ec = ev->container;
+    int ret;
+    if (!ec)
+    {
+        return BSP_RTN_INVALID;
+    }
+
+    bsp_spin_lock(&ec->sq_lock);
+    ret = _uring_arm(ec, f);
+    bsp_spin_unlock(&ec->sq_lock);
+    if (BSP_RTN_SUCCESS != ret)
+    {
+        bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Add event failed");
+
+        return ret;
+    }
+
+    if (BSP_TRUE != _container_is_owner(ec))
+    {
+        _uring_submit(ec);
+    }
+
+    bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Arm event %d in container %d with event %d", fd, ec->ring_fd, ev->events);
+
+    return BSP_RTN_SUCCESS;
+}
+
+// Arm poll requests of a batch of fds with one submission
+BSP_DECLARE(size_t) bsp_set_event_batch(BSP_EVENT_CONTAINER *ec, const int *fds, size_t nfds)
+{
+    BSP_FD *f;
+    size_t i, armed = 0;
+    if (!ec || !fds || 0 == nfds)
+    {
+        return 0;
+    }
+
+    bsp_spin_lock(&ec->sq_lock);
+    for (i = 0; i < nfds; i ++)
+    {
+        f = bsp_get_fd(fds[i], BSP_FD_ANY);
+        if (f && f->event.container == ec && BSP_RTN_SUCCESS == _uring_arm(ec, f))
+        {
+            armed ++;
+        }
+    }
+
+    bsp_spin_unlock(&ec->sq_lock);
+    if (BSP_TRUE != _container_is_owner(ec))
+    {
+        _uring_submit(ec);
+    }
+
+    bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Arm %d events in container %d", (int) armed, ec->ring_fd);
+
+    return armed;
+}
+
+// Poll requests are oneshot and re-armed level-checked after each completion, nothing to do
+BSP_DECLARE(int) bsp_rearm_event(int fd)
+{
+    return (bsp_get_fd(fd, BSP_FD_ANY)) ? BSP_RTN_SUCCESS : BSP_RTN_INVALID;
+}
+
+// Delete an event from container
+BSP_DECLARE(int) bsp_del_event(int fd)
+{
+    BSP_FD *f = bsp_get_fd(fd, BSP_FD_ANY);
+    if (!f)
+    {
+        return BSP_RTN_INVALID;
+    }
+
+    BSP_EVENT_SPEC *ev = FD_EVENT(f);
+    BSP_EVENT_CONTAINER *ec = ev->container;
+    int ret = BSP_RTN_SUCCESS;
+    if (!ec)
+    {
+        return BSP_RTN_INVALID;
+    }
+
+    bsp_spin_lock(&ec->sq_lock);
+    if (ev->registered)
+    {
+        ret = _uring_queue_remove(ec, f);
+    }
+
+    if (BSP_RTN_SUCCESS == ret && BSP_TRUE == ev->io_queued)
+    {
+        // Kernel keeps file referenced, pending IO would complete into buffers freed after close
+        ret = _uring_queue_cancel_io(ec, f);
+        ev->io_queued = BSP_FALSE;
+    }
+
+    // Completions of old serial will be dropped
+    ev->serial = 0;
+    ev->registered = 0;
+
+    bsp_spin_unlock(&ec->sq_lock);
+    if (BSP_RTN_SUCCESS != ret)
+    {
+        bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Delete event failed");
+
+        return ret;
+    }
+
+    if (BSP_TRUE != _container_is_owner(ec))
+    {
+        _uring_submit(ec);
+    }
+
+    bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Delete event %d from container", fd);
+
+    return BSP_RTN_SUCCESS;
+}
+
+// Submit pending requests and wait for completions
+BSP_PRIVATE(int) _uring_wait(BSP_EVENT_CONTAINER *ec)
+{
+    unsigned int head = *ec->cq_head;
+    unsigned int tail = __atomic_load_n(ec->cq_tail, __ATOMIC_ACQUIRE);
+    unsigned int to_submit;
+    int ret, timeout, nevents = 0;
+
+    bsp_spin_lock(&ec->sq_lock);
+    to_submit = ec->sq_pending;
+    ec->sq_pending = 0;
+    bsp_spin_unlock(&ec->sq_lock);
+    timeout = (head == tail) ? bsp_timer_timeout(ec) : 0;
+    if (0 != timeout && BSP_TRUE == _wake_prepare_sleep(ec))
+    {
+        // Block here, until next timer
+        ret = _uring_enter_wait(ec->ring_fd, to_submit, timeout);
+    }
+    else if (to_submit > 0)
+    {
+        ret = _uring_enter(ec->ring_fd, to_submit, 0, 0);
+    }
+    else
+    {
+        ret = 0;
+    }
+
+    if (ret < 0)
+    {
+        ret = 0;
+    }
+
+    if ((unsigned int) ret < to_submit)
+    {
+        // Some requests were not consumed by kernel
+        bsp_spin_lock(&ec->sq_lock);
+        ec->sq_pending += to_submit - ret;
+        bsp_spin_unlock(&ec->sq_lock);
+    }
+
+    tail = __atomic_load_n(ec->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail && nevents < BSP_EVENT_QUEUE_LENGTH)
+    {
+        ec->event_queue[nevents ++] = ec->cqes[head & *ec->cq_mask];
+        head ++;
+    }
+
+    __atomic_store_n(ec->cq_head, head, __ATOMIC_RELEASE);
+
+    return nevents;
+}
+
+// Resolve a CQE to fd, with triggered mask
+BSP_PRIVATE(BSP_FD *) _uring_fetch(BSP_EVENT_CONTAINER *ec, struct io_uring_cqe *cqe, int *triggered)
+{
+    int op = _URING_DATA_OP(cqe->user_data);
+    int fd = _URING_DATA_FD(cqe->user_data);
+    uint32_t serial = _URING_DATA_SERIAL(cqe->user_data);
+    uint32_t mask;
+    BSP_BOOLEAN stale;
+    if (_URING_OP_CANCEL == op)
+    {
+        // Result of removal
+        return NULL;
+    }
+
+    bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Try to fetch event %d from container : %d", fd, cqe->res);
+    BSP_FD *f = bsp_get_fd(fd, BSP_FD_ANY);
+    BSP_EVENT_SPEC *ev = (f) ? FD_EVENT(f) : NULL;
+    if (_URING_OP_POLL == op)
+    {
+        if (!f || cqe->res < 0)
+        {
+            // Gone or cancelled
+            return NULL;
+        }
+
+        bsp_spin_lock(&ec->sq_lock);
+        if (ev->container != ec || 0 == ev->serial || serial != ev->serial)
+        {
+            // Stale completion of an old arm
+            bsp_spin_unlock(&ec->sq_lock);
+
+            return NULL;
+        }
+
+        *triggered = _decode_events(f, (uint32_t) cqe->res);
+
+        // Poll requests are oneshot, re-arm it. POLLOUT is level-triggered, so a reported
+        // write interest is dropped until asked again, instead of being reported on every loop
+        mask = _uring_poll_mask(f) & ~((uint32_t) cqe->res & POLLOUT);
+        ev->registered = 0;
+        _uring_queue_poll(ec, f, mask);
+        bsp_spin_unlock(&ec->sq_lock);
+
+        return f;
+    }
+
+    stale = (!f || ev->container != ec || (__atomic_load_n(&f->gen, __ATOMIC_ACQUIRE) & 0xFFFFFF) != serial) ? BSP_TRUE : BSP_FALSE;
+    if (BSP_TRUE == stale)
+    {
+        if (_URING_OP_ACCEPT == op && cqe->res >= 0)
+        {
+            // Nobody will take this connection
+            close(cqe->res);
+        }
+
+        bsp_trace_message(BSP_TRACE_NOTICE, _tag_, "Completion of fd %d dropped, fd no longer registered", fd);
+
+        return NULL;
+    }
+
+    switch (op)
+    {
+        case _URING_OP_READ : 
+            *triggered = BSP_EVENT_READ_COMPLETE;
+            ev->read_result = cqe->res;
+            break;
+        case _URING_OP_WRITE : 
+            *triggered = BSP_EVENT_WRITE_COMPLETE;
+            ev->write_result = cqe->res;
+            break;
+        case _URING_OP_ACCEPT : 
+            *triggered = BSP_EVENT_ACCEPT_COMPLETE;
+            ev->read_result = cqe->res;
+            break;
+        default : 
+            return NULL;
+    }
+
+    return f;
+}
+
+// Wait and fill active list of container
+BSP_PRIVATE(int) _harvest_events(BSP_EVENT_CONTAINER *ec)
+{
+    int nevents = _uring_wait(ec);
+    int i, total = 0, triggered;
+    BSP_BOOLEAN poked = _wake_finish_sleep(ec);
+    BSP_FD *f = NULL;
+    BSP_EVENT_SPEC *ev = NULL;
+
+    // One fd may complete several requests in one batch, merge them
+    ec->harvest_seq ++;
+    for (i = 0; i < nevents; i ++)
+    {
+        triggered = 0;
+        f = _uring_fetch(ec, &ec->event_queue[i], &triggered);
+        if (!f)
+        {
+            continue;
+        }
+
+        ev = FD_EVENT(f);
+        if (f->fd == ec->notify_fd)
+        {
+            poked = BSP_FALSE;
+        }
+
+        if (ev->harvest == ec->harvest_seq)
+        {
+            ev->triggered |= triggered;
+        }
+        else
+        {
+            ev->harvest = ec->harvest_seq;
+            ev->triggered = triggered;
+            ec->active_fds[total ++] = f;
+        }
+    }
+
+    if (BSP_TRUE == poked)
+    {
+        total = _wake_notify(ec, total);
+    }
+
+    return total;
+}
+
+// Submit a completion-style read
+BSP_DECLARE(int) bsp_submit_read(int fd, char *buf, size_t len)
+{
+    BSP_FD *f = bsp_get_fd(fd, BSP_FD_ANY);
+    if (!f || !buf)
+    {
+        return BSP_RTN_INVALID;
+    }
+
+    return _uring_queue_io(f, _URING_OP_READ, (void *) buf, len, NULL);
+}
+
+// Submit a completion-style write
+BSP_DECLARE(int) bsp_submit_write(int fd, const char *data, size_t len)
+{
+    BSP_FD *f = bsp_get_fd(fd, BSP_FD_ANY);
+    if (!f || !data)
+    {
+        return BSP_RTN_INVALID;
+    }
+
+    return _uring_queue_io(f, _URING_OP_WRITE, (void *) data, len, NULL);
+}
+
+// Submit a completion-style accept
+BSP_DECLARE(int) bsp_submit_accept(int fd, struct sockaddr *addr, socklen_t *addrlen)
+{
+    BSP_FD *f = bsp_get_fd(fd, BSP_FD_SOCKET_SERVER);
+    if (!f)
+    {
+        return BSP_RTN_INVALID;
+    }
+
+    return _uring_queue_io(f, _URING_OP_ACCEPT, (void *) addr, 0, (void *) addrlen);
+}
+
+// }}}
+
+#elif defined(EVENT_USE_EPOLL)
 // {{{ Epoll implementation
 #include <sys/epoll.h>
 // Create a new kernel event container
@@ -97,6 +1081,7 @@ BSP_DECLARE(BSP_EVENT_CONTAINER *) bsp_new_event_container()
     }
 
     ec->epoll_fd = epoll_fd;
+    bsp_spin_init(&ec->change_lock);
     bsp_trace_message(BSP_TRACE_INFORMATIONAL, _tag_, "Create new event container %d with Epoll", epoll_fd);
 
     // Create event fd
@@ -137,6 +1122,8 @@ BSP_DECLARE(int) bsp_del_event_container(BSP_EVENT_CONTAINER *ec)
     if (ec)
     {
         close(ec->epoll_fd);
+        bsp_free(ec->changes);
+        bsp_del_timer_wheel(ec->timer_wheel);
         bsp_free(ec);
         bsp_trace_message(BSP_TRACE_WARNING, _tag_, "Event container closed, BSP_EVENT_DATA leak should be occured");
 
@@ -146,25 +1133,162 @@ BSP_DECLARE(int) bsp_del_event_container(BSP_EVENT_CONTAINER *ec)
     return BSP_RTN_INVALID;
 }
 
-// Send notify to container
-BSP_DECLARE(int) bsp_poke_event_container(BSP_EVENT_CONTAINER *ec)
+// Epoll mask of fd
+BSP_PRIVATE(uint32_t) _epoll_mask(BSP_FD *f)
 {
-    if (ec)
+    BSP_EVENT_SPEC *ev = FD_EVENT(f);
+    uint32_t mask = EPOLLET;
+    if (BSP_FD_TIMER == f->type)
     {
-        uint64_t v = 1;
-        ssize_t ret = write(ec->notify_fd, (const void *) &v, 8);
+        return mask | EPOLLIN;
+    }
 
-        return (8 == ret) ? BSP_RTN_SUCCESS : BSP_RTN_ERR_GENERAL;
+    // EPOLLERR | EPOLLHUP were always triggered by epoll
+#ifdef EPOLLRDHUP
+    mask |= EPOLLRDHUP;
+#endif
+    if (ev->events & BSP_EVENT_READ || ev->events & BSP_EVENT_ACCEPT || ev->events & BSP_EVENT_EVENT || ev->events & BSP_EVENT_SIGNAL)
+    {
+        // Add READ event
+        mask |= EPOLLIN;
+    }
+
+    if (ev->events & BSP_EVENT_WRITE)
+    {
+        // Add WRITE event
+        mask |= EPOLLOUT;
+    }
+
+    return mask;
+}
+
+// Apply event of fd to kernel. change_lock must be held
+BSP_PRIVATE(int) _epoll_apply(BSP_EVENT_CONTAINER *ec, BSP_FD *f)
+{
+    struct epoll_event ee;
+    BSP_EVENT_SPEC *ev = FD_EVENT(f);
+    uint32_t mask = _epoll_mask(f);
+    int op = (ev->registered) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    ev->pending = BSP_FALSE;
+
+    // Edge triggered, a repeated WRITE request or a re-arm needs a MOD to get a new edge
+    if (ev->registered == mask && !(mask & EPOLLOUT) && !ev->rearm)
+    {
+        return BSP_RTN_SUCCESS;
+    }
+
+    ev->rearm = BSP_FALSE;
+
+    bzero(&ee, sizeof(struct epoll_event));
+    ee.events = mask;
+    ee.data.u64 = FD_HANDLE(f);
+    if (0 != epoll_ctl(ec->epoll_fd, op, f->fd, &ee))
+    {
+        // Kernel may hold a different state (Fd closed or duplicated), try another way
+        if (EEXIST == errno || ENOENT == errno)
+        {
+            op = (EEXIST == errno) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+            if (0 == epoll_ctl(ec->epoll_fd, op, f->fd, &ee))
+            {
+                ev->registered = mask;
+
+                return BSP_RTN_SUCCESS;
+            }
+        }
+
+        bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Set event of fd %d failed : %s", f->fd, strerror(errno));
+
+        return BSP_RTN_ERR_EVENT_EPOLL;
+    }
+
+    ev->registered = mask;
+    bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "%s event %d in container %d with event %d", (EPOLL_CTL_ADD == op) ? "Add" : "Modify", f->fd, ec->epoll_fd, ev->events);
+
+    return BSP_RTN_SUCCESS;
+}
+
+/*
+ * Apply all pending changes before wait. A change failed here was already reported
+ * as success to its caller, fd could never trigger again. Such fds are put to the
+ * head of active list as errored, returns number of them
+ */
+BSP_PRIVATE(int) _epoll_flush_changes(BSP_EVENT_CONTAINER *ec)
+{
+    size_t i;
+    int failed = 0;
+    BSP_FD *f = NULL;
+    BSP_EVENT_SPEC *ev = NULL;
+    if (0 == ec->nchanges)
+    {
+        return 0;
+    }
+
+    bsp_spin_lock(&ec->change_lock);
+    for (i = 0; i < ec->nchanges && failed < BSP_EVENT_QUEUE_LENGTH / 2; i ++)
+    {
+        f = bsp_get_fd_by_handle(ec->changes[i], BSP_FD_ANY);
+        if (!f)
+        {
+            continue;
+        }
+
+        ev = FD_EVENT(f);
+        if (BSP_TRUE == ev->pending && ev->container == ec && BSP_TRUE == bsp_fd_handle_valid(f, ec->changes[i]) && 
+            BSP_RTN_SUCCESS != _epoll_apply(ec, f))
+        {
+            // Closed by its loop like a hangup
+            bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Deferred event change of fd %d failed, report it as errored", f->fd);
+            ev->triggered = BSP_EVENT_ERROR | BSP_EVENT_LOCAL_HUP;
+            ec->active_fds[failed ++] = f;
+        }
+    }
+
+    // Active list half filled by failures, the rest are applied before next wait
+    if (i < ec->nchanges)
+    {
+        memmove(ec->changes, ec->changes + i, (ec->nchanges - i) * sizeof(BSP_FD_HANDLE));
+    }
+
+    ec->nchanges -= i;
+    bsp_spin_unlock(&ec->change_lock);
+
+    return failed;
+}
+
+// Queue fd into change list. change_lock must be held
+BSP_PRIVATE(int) _epoll_queue_change(BSP_EVENT_CONTAINER *ec, BSP_FD *f)
+{
+    BSP_EVENT_SPEC *ev = FD_EVENT(f);
+    if (BSP_TRUE == ev->pending)
+    {
+        // Already in list
+        return BSP_RTN_SUCCESS;
+    }
+
+    if (ec->nchanges >= ec->changes_size)
+    {
+        size_t new_size = (ec->changes_size > 0) ? ec->changes_size * 2 : _BSP_EVENT_CHANGE_LIST_INITIAL;
+        BSP_FD_HANDLE *new_list = bsp_realloc(ec->changes, new_size * sizeof(BSP_FD_HANDLE));
+        if (!new_list)
+        {
+            // Apply directly
+            return _epoll_apply(ec, f);
+        }
+
+        ec->changes = new_list;
+        ec->changes_size = new_size;
     }
 
-    return BSP_RTN_INVALID;
+    ec->changes[ec->nchanges ++] = FD_HANDLE(f);
+    ev->pending = BSP_TRUE;
+
+    return BSP_RTN_SUCCESS;
 }
 
-// Add an event to container
+// Set (add or modify) an event to container
+// Changes made by loop thread of container are deferred to next wait, others are applied immediately
 BSP_DECLARE(int) bsp_set_event(int fd)
 {
-    struct epoll_event ee;
-    bzero(&ee, sizeof(struct epoll_event));
     BSP_FD *f = bsp_get_fd(fd, BSP_FD_ANY);
     if (!f)
     {
@@ -172,79 +1296,73 @@ BSP_DECLARE(int) bsp_set_event(int fd)
     }
 
     BSP_EVENT_SPEC *ev = FD_EVENT(f);
-    BSP_TIMER *tmr = NULL;
-    if (ev && ev->container)
+    BSP_EVENT_CONTAINER *ec = ev->container;
+    int ret;
+    if (!ec)
     {
-        switch (f->type)
-        {
-            case BSP_FD_TIMER : 
-                // Timerfd in Linux
-                tmr = (BSP_TIMER *) FD_PTR(f);
-                if (!tmr || (0 == tmr->spec.it_value.tv_sec && 0 == tmr->spec.it_value.tv_nsec))
-                {
-                    // Stopped timer
-                    return BSP_RTN_INVALID;
-                }
+        return BSP_RTN_INVALID;
+    }
 
-                if (-1 == timerfd_settime(fd, 0, &tmr->spec, NULL))
-                {
-                    return BSP_RTN_ERR_EVENT_TFD;
-                }
+    BSP_BOOLEAN owner = _container_is_owner(ec);
+    bsp_spin_lock(&ec->change_lock);
+    if (BSP_TRUE == owner)
+    {
+        ret = _epoll_queue_change(ec, f);
+    }
+    else
+    {
+        // Epoll wakes the waiter itself, no poke needed
+        ret = _epoll_apply(ec, f);
+    }
 
-                ee.events = EPOLLET | EPOLLIN;
-                break;
-            default : 
-                // IO events
-                ee.events = EPOLLET;
-                // EPOLLERR | EPOLLHUP were always triggered by epoll
-#ifdef EPOLLRDHUP
-                ee.events |= EPOLLRDHUP;
-#endif
-                if (ev->events & BSP_EVENT_READ || ev->events & BSP_EVENT_ACCEPT || ev->events & BSP_EVENT_EVENT || ev->events & BSP_EVENT_SIGNAL)
-                {
-                    // Add READ event
-                    ee.events |= EPOLLIN;
-                }
+    bsp_spin_unlock(&ec->change_lock);
 
-                if (ev->events & BSP_EVENT_WRITE)
-                {
-                    // Add WRITE event
-                    ee.events |= EPOLLOUT;
-                }
+    return ret;
+}
 
-                break;
-        }
+// Set events of a batch of fds, queued into change list of container together
+// Another thread pokes the container once instead of one epoll_ctl for each fd
+BSP_DECLARE(size_t) bsp_set_event_batch(BSP_EVENT_CONTAINER *ec, const int *fds, size_t nfds)
+{
+    BSP_FD *f;
+    size_t i, queued = 0;
+    if (!ec || !fds || 0 == nfds)
+    {
+        return 0;
+    }
 
-        ee.data.fd = fd;
-        // Try add first
-        if (0 == epoll_ctl(ev->container->epoll_fd, EPOLL_CTL_ADD, fd, &ee))
+    bsp_spin_lock(&ec->change_lock);
+    for (i = 0; i < nfds; i ++)
+    {
+        f = bsp_get_fd(fds[i], BSP_FD_ANY);
+        if (f && f->event.container == ec && BSP_RTN_SUCCESS == _epoll_queue_change(ec, f))
         {
-            bsp_poke_event_container(ev->container);
-            bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Add event %d to container %d with event %d", fd, ev->container->epoll_fd, ev->events);
-
-            return BSP_RTN_SUCCESS;
+            queued ++;
         }
-        else
-        {
-            if (EEXIST == errno && BSP_FD_TIMER != f->type)
-            {
-                // Try mod
-                if (0 == epoll_ctl(ev->container->epoll_fd, EPOLL_CTL_MOD, fd, &ee))
-                {
-                    bsp_poke_event_container(ev->container);
-                    bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Modify event %d in container %d with event %d", fd, ev->container->epoll_fd, ev->events);
+    }
 
-                    return BSP_RTN_SUCCESS;
-                }
-            }
+    bsp_spin_unlock(&ec->change_lock);
+    if (queued > 0 && BSP_TRUE != _container_is_owner(ec))
+    {
+        // Changes applied by container before its next wait
+        bsp_poke_event_container(ec);
+    }
 
-            bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Add event failed");
+    return queued;
+}
 
-            return BSP_RTN_ERR_EVENT_EPOLL;
-        }
+// Force a new edge of fd, reported again by next wait if still ready
+BSP_DECLARE(int) bsp_rearm_event(int fd)
+{
+    BSP_FD *f = bsp_get_fd(fd, BSP_FD_ANY);
+    if (!f)
+    {
+        return BSP_RTN_INVALID;
     }
 
-    return BSP_RTN_INVALID;
+    f->event.rearm = BSP_TRUE;
+
+    return bsp_set_event(fd);
 }
 /*
 // Modify an event from container
@@ -345,47 +1463,36 @@ BSP_DECLARE(int) bsp_del_event(int fd)
     }
 
     BSP_EVENT_SPEC *ev = FD_EVENT(f);
-    BSP_TIMER *tmr = NULL;
-    if (ev && ev->container)
+    BSP_EVENT_CONTAINER *ec = ev->container;
+    int ret = BSP_RTN_SUCCESS;
+    if (!ec)
     {
-        switch (f->type)
-        {
-            case BSP_FD_TIMER : 
-                // Timerfd, stop it first
-                tmr = (BSP_TIMER *) FD_PTR(f);
-                tmr->spec.it_value.tv_sec = 0;
-                tmr->spec.it_value.tv_nsec = 0;
-                tmr->spec.it_interval.tv_sec = 0;
-                tmr->spec.it_interval.tv_nsec = 0;
-                if (-1 == timerfd_settime(fd, 0, &tmr->spec, NULL))
-                {
-                    bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Timerfd settime failed");
-
-                    return BSP_RTN_ERR_EVENT_TFD;
-                }
-
-                break;
-            default : 
-                break;
-        }
+        return BSP_RTN_INVALID;
+    }
 
+    // Deletion cannot be deferred, fd may be closed and reused right after
+    bsp_spin_lock(&ec->change_lock);
+    ev->pending = BSP_FALSE;
+    if (ev->registered)
+    {
         // Before Linux 2.6.9, the EPOLL_CTL_DEL required a non-null pointer in event
         ee.data.u64 = 0;
-        if (0 == epoll_ctl(ev->container->epoll_fd, EPOLL_CTL_DEL, fd, &ee))
+        if (0 == epoll_ctl(ec->epoll_fd, EPOLL_CTL_DEL, fd, &ee))
         {
             bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Delete event %d from container", fd);
-
-            return BSP_RTN_SUCCESS;
         }
         else
         {
             bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Delete event failed");
-
-            return BSP_RTN_ERR_EVENT_EPOLL;
+            ret = BSP_RTN_ERR_EVENT_EPOLL;
         }
+
+        ev->registered = 0;
     }
 
-    return BSP_RTN_INVALID;
+    bsp_spin_unlock(&ec->change_lock);
+
+    return ret;
 }
 /*
 // Wait for events trigger
@@ -401,148 +1508,95 @@ BSP_DECLARE(int) bsp_wait_events(BSP_EVENT_CONTAINER *ec)
     return nfds;
 }
 */
-// Get appointed active event from container
-BSP_DECLARE(BSP_FD *) bsp_get_active_fd(BSP_EVENT_CONTAINER *ec)
+// Wait and fill active list of container
+BSP_PRIVATE(int) _harvest_events(BSP_EVENT_CONTAINER *ec)
 {
-    if (!ec)
-    {
-        return NULL;
-    }
-
-    
-    if (0 == ec->active_total || ec->active_curr >= (ec->active_total - 1))
-    {
-        // Block here
-        ec->active_total = epoll_wait(ec->epoll_fd, ec->event_queue, BSP_EVENT_QUEUE_LENGTH, -1);
-        ec->active_curr = 0;
-    }
+    int failed = _epoll_flush_changes(ec);
 
-    uint64_t notify_data = 0;
-    struct epoll_event *ee = &ec->event_queue[ec->active_curr ++];
-    if (!ee)
+    // Block here until next timer, unless a poke is pending
+    int timeout = (failed > 0) ? 0 : bsp_timer_timeout(ec);
+    if (0 != timeout && BSP_TRUE != _wake_prepare_sleep(ec))
     {
-        bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Cannot get active event from list");
-
-        return NULL;
+        timeout = 0;
     }
 
-    bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Try to fetch event %d from container : %d", ee->data.fd, ee->events);
-    ssize_t ret = 0;
-    BSP_FD *f = bsp_get_fd(ee->data.fd, BSP_FD_ANY);
-    if (!f)
-    {
-        return NULL;
-    }
+    int nevents = epoll_wait(ec->epoll_fd, ec->event_queue, BSP_EVENT_QUEUE_LENGTH - failed, timeout);
+    int i, j, total = failed, triggered;
+    BSP_BOOLEAN poked = _wake_finish_sleep(ec);
+    struct epoll_event *ee = NULL;
+    BSP_FD *f = NULL;
 
-    BSP_EVENT_SPEC *ev = FD_EVENT(f);
-    ev->triggered = 0;
-    if (ee->events & EPOLLIN)
+    for (i = 0; i < nevents; i ++)
     {
-        switch (f->type)
+        ee = &ec->event_queue[i];
+        bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Try to fetch event %d from container : %d", HANDLE_FD(ee->data.u64), ee->events);
+        f = bsp_get_fd_by_handle(ee->data.u64, BSP_FD_ANY);
+        if (!f)
         {
-            case BSP_FD_SIGNAL : 
-                ev->triggered |= BSP_EVENT_SIGNAL;
-                break;
-            case BSP_FD_TIMER : 
-                ret = read(ee->data.fd, (void *) &notify_data, 8);
-                if (8 == ret)
-                {
-                    ev->triggered |= BSP_EVENT_TIMER;
-                }
-
-                break;
-            case BSP_FD_EVENT : 
-                ret = read(ee->data.fd, (void *) &notify_data, 8);
-                if (8 == ret)
-                {
-                    ev->triggered |= BSP_EVENT_EVENT;
-                }
+            // Fd closed or reused
+            continue;
+        }
 
-                break;
-            case BSP_FD_SOCKET_SERVER_TCP : 
-            case BSP_FD_SOCKET_SERVER_SCTP : 
-                ev->triggered |= BSP_EVENT_ACCEPT;
-                break;
-            case BSP_FD_GENERAL : 
-            case BSP_FD_PIPE : 
-            case BSP_FD_SOCKET_SERVER_UDP : 
-            case BSP_FD_SOCKET_CLIENT_TCP : 
-            case BSP_FD_SOCKET_CLIENT_SCTP : 
-            case BSP_FD_SOCKET_CONNECTOR_TCP : 
-            case BSP_FD_SOCKET_CONNECTOR_SCTP : 
-                ev->triggered |= BSP_EVENT_READ;
-                break;
-            default : 
-                // Do nothing
-                break;
+        if (f->fd == ec->notify_fd)
+        {
+            poked = BSP_FALSE;
         }
-    }
 
-    if (ee->events & EPOLLOUT)
-    {
-        switch (f->type)
+        // Epoll reports each fd once per wait
+        triggered = _decode_events(f, ee->events);
+        if (BSP_TRUE != bsp_fd_handle_valid(f, ee->data.u64))
         {
-            case BSP_FD_GENERAL : 
-            case BSP_FD_SOCKET_CLIENT_TCP : 
-            case BSP_FD_SOCKET_CLIENT_SCTP : 
-            case BSP_FD_SOCKET_CLIENT_LOCAL : 
-            case BSP_FD_SOCKET_CONNECTOR_TCP : 
-            case BSP_FD_SOCKET_CONNECTOR_UDP : 
-            case BSP_FD_SOCKET_CONNECTOR_SCTP : 
-            case BSP_FD_SOCKET_CONNECTOR_LOCAL : 
-            case BSP_FD_SOCKET_SERVER_UDP : 
-                ev->triggered |= BSP_EVENT_WRITE;
-                break;
-            default : 
-                // Do nothing
-                break;
+            // Reused while decoding
+            continue;
         }
-    }
 
-    if (ee->events & EPOLLHUP)
-    {
-        switch (f->type)
+        for (j = 0; j < failed; j ++)
         {
-            case BSP_FD_SOCKET_CLIENT_TCP : 
-            case BSP_FD_SOCKET_CLIENT_SCTP : 
-            case BSP_FD_SOCKET_CLIENT_LOCAL : 
-            case BSP_FD_SOCKET_CONNECTOR_TCP : 
-            case BSP_FD_SOCKET_CONNECTOR_SCTP : 
-            case BSP_FD_SOCKET_CONNECTOR_LOCAL : 
-                ev->triggered |= BSP_EVENT_LOCAL_HUP;
-                break;
-            default : 
-                // Do nothing
+            if (ec->active_fds[j] == f)
+            {
                 break;
+            }
         }
-    }
 
-#ifdef EPOLLRDHUP
-    if (ee->events & EPOLLRDHUP)
-    {
-        switch (f->type)
+        if (j < failed)
         {
-            case BSP_FD_SOCKET_CLIENT_TCP : 
-            case BSP_FD_SOCKET_CLIENT_SCTP : 
-            case BSP_FD_SOCKET_CLIENT_LOCAL : 
-            case BSP_FD_SOCKET_CONNECTOR_TCP : 
-            case BSP_FD_SOCKET_CONNECTOR_SCTP : 
-            case BSP_FD_SOCKET_CONNECTOR_LOCAL : 
-                ev->triggered |= BSP_EVENT_REMOTE_HUP;
-                break;
-            default : 
-                // Do nothing
-                break;
+            // Already listed as errored
+            f->event.triggered |= triggered;
+            continue;
         }
+
+        f->event.triggered = triggered;
+        ec->active_fds[total ++] = f;
     }
 
-#endif
-    if (ee->events & EPOLLERR)
+    if (BSP_TRUE == poked)
     {
-        ev->events |= BSP_EVENT_ERROR;
+        total = _wake_notify(ec, total);
     }
 
-    return f;
+    return total;
+}
+
+// Completion-style IO not supported by epoll
+BSP_DECLARE(int) bsp_submit_read(int fd, char *buf, size_t len)
+{
+    bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Completion IO not supported by epoll");
+
+    return BSP_RTN_INVALID;
+}
+
+BSP_DECLARE(int) bsp_submit_write(int fd, const char *data, size_t len)
+{
+    bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Completion IO not supported by epoll");
+
+    return BSP_RTN_INVALID;
+}
+
+BSP_DECLARE(int) bsp_submit_accept(int fd, struct sockaddr *addr, socklen_t *addrlen)
+{
+    bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Completion IO not supported by epoll");
+
+    return BSP_RTN_INVALID;
 }
 
 // 
@@ -559,3 +1613,92 @@ BSP_DECLARE(BSP_FD *) bsp_get_active_fd(BSP_EVENT_CONTAINER *ec)
 // }}}
 
 #endif
+
+#if defined(EVENT_USE_IO_URING) || defined(EVENT_USE_EPOLL)
+// Send notify to container
+// Only a sleeping container without pending notification costs a write
+BSP_DECLARE(int) bsp_poke_event_container(BSP_EVENT_CONTAINER *ec)
+{
+    if (ec)
+    {
+        uint64_t v = 1;
+        ssize_t ret;
+        int old = __atomic_fetch_or(&ec->wake_state, _WAKE_PENDING, __ATOMIC_SEQ_CST);
+        __atomic_fetch_add(&ec->poke_total, 1, __ATOMIC_RELAXED);
+        if ((old & _WAKE_PENDING) || !(old & _WAKE_SLEEPING))
+        {
+            // Already notified, or container will see pending flag before next wait
+            __atomic_fetch_add(&ec->poke_elided, 1, __ATOMIC_RELAXED);
+
+            return BSP_RTN_SUCCESS;
+        }
+
+        __atomic_fetch_add(&ec->poke_sent, 1, __ATOMIC_RELAXED);
+        ret = write(ec->notify_fd, (const void *) &v, 8);
+
+        return (8 == ret) ? BSP_RTN_SUCCESS : BSP_RTN_ERR_GENERAL;
+    }
+
+    return BSP_RTN_INVALID;
+}
+
+// Get poke counters of container
+BSP_DECLARE(int) bsp_poke_event_stat(BSP_EVENT_CONTAINER *ec, BSP_EVENT_POKE_STAT *stat)
+{
+    if (!ec || !stat)
+    {
+        return BSP_RTN_INVALID;
+    }
+
+    stat->total = __atomic_load_n(&ec->poke_total, __ATOMIC_RELAXED);
+    stat->elided = __atomic_load_n(&ec->poke_elided, __ATOMIC_RELAXED);
+    stat->sent = __atomic_load_n(&ec->poke_sent, __ATOMIC_RELAXED);
+
+    return BSP_RTN_SUCCESS;
+}
+
+// Get all active fds from container
+BSP_DECLARE(BSP_FD **) bsp_get_active_fds(BSP_EVENT_CONTAINER *ec, int *total)
+{
+    if (!ec)
+    {
+        if (total)
+        {
+            *total = 0;
+        }
+
+        return NULL;
+    }
+
+    ec->active_total = _harvest_events(ec);
+    ec->active_curr = ec->active_total;
+    if (total)
+    {
+        *total = ec->active_total;
+    }
+
+    return ec->active_fds;
+}
+
+// Get appointed active event from container
+BSP_DECLARE(BSP_FD *) bsp_get_active_fd(BSP_EVENT_CONTAINER *ec)
+{
+    if (!ec)
+    {
+        return NULL;
+    }
+
+    if (ec->active_curr >= ec->active_total)
+    {
+        bsp_get_active_fds(ec, NULL);
+        ec->active_curr = 0;
+    }
+
+    if (ec->active_curr >= ec->active_total)
+    {
+        return NULL;
+    }
+
+    return ec->active_fds[ec->active_curr ++];
+}
+#endif
@@ -65,8 +65,17 @@ typedef enum bsp_event_type_e
     BSP_EVENT_REMOTE_HUP
                         = 0x80, 
 #define BSP_EVENT_REMOTE_HUP            BSP_EVENT_REMOTE_HUP
-    BSP_EVENT_ERROR     = 0x100
+    BSP_EVENT_ERROR     = 0x100, 
 #define BSP_EVENT_ERROR                 BSP_EVENT_ERROR
+    BSP_EVENT_READ_COMPLETE
+                        = 0x200, 
+#define BSP_EVENT_READ_COMPLETE         BSP_EVENT_READ_COMPLETE
+    BSP_EVENT_WRITE_COMPLETE
+                        = 0x400, 
+#define BSP_EVENT_WRITE_COMPLETE        BSP_EVENT_WRITE_COMPLETE
+    BSP_EVENT_ACCEPT_COMPLETE
+                        = 0x800
+#define BSP_EVENT_ACCEPT_COMPLETE       BSP_EVENT_ACCEPT_COMPLETE
 } BSP_EVENT_TYPE;
 
 typedef enum bsp_event_modify_method_e
@@ -82,7 +91,55 @@ typedef enum bsp_event_modify_method_e
 /* Macros */
 
 /* Structs */
-#if defined(EVENT_USE_EPOLL)
+typedef struct bsp_event_poke_stat_t
+{
+    uint64_t            total;
+    uint64_t            elided;
+    uint64_t            sent;
+} BSP_EVENT_POKE_STAT;
+
+
+#if defined(EVENT_USE_IO_URING)
+// {{{ IO_uring
+#include <linux/io_uring.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+struct bsp_event_container_t
+{
+    int                 ring_fd;
+    int                 notify_fd;
+    void                *sq_ring;
+    void                *cq_ring;
+    struct io_uring_sqe *sqes;
+    size_t              sq_ring_size;
+    size_t              cq_ring_size;
+    size_t              sqes_size;
+    unsigned int        *sq_head;
+    unsigned int        *sq_tail;
+    unsigned int        *sq_mask;
+    unsigned int        *sq_array;
+    unsigned int        sq_entries;
+    unsigned int        *cq_head;
+    unsigned int        *cq_tail;
+    unsigned int        *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned int        sq_pending;
+    uint32_t            serial;
+    BSP_SPINLOCK        sq_lock;
+    int                 wake_state;
+    uint64_t            poke_total;
+    uint64_t            poke_elided;
+    uint64_t            poke_sent;
+    struct bsp_timer_wheel_t
+                        *timer_wheel;
+    struct io_uring_cqe event_queue[BSP_EVENT_QUEUE_LENGTH];
+    BSP_FD              *active_fds[BSP_EVENT_QUEUE_LENGTH];
+    unsigned int        harvest_seq;
+    int                 active_total;
+    int                 active_curr;
+};
+// }}} ~IO_uring
+#elif defined(EVENT_USE_EPOLL)
 // {{{ Epoll
 #include <sys/epoll.h>
 #include <sys/timerfd.h>
@@ -91,7 +148,18 @@ struct bsp_event_container_t
 {
     int                 epoll_fd;
     int                 notify_fd;
+    int                 wake_state;
+    uint64_t            poke_total;
+    uint64_t            poke_elided;
+    uint64_t            poke_sent;
+    struct bsp_timer_wheel_t
+                        *timer_wheel;
     struct epoll_event  event_queue[BSP_EVENT_QUEUE_LENGTH];
+    BSP_FD              *active_fds[BSP_EVENT_QUEUE_LENGTH];
+    BSP_FD_HANDLE       *changes;
+    size_t              changes_size;
+    size_t              nchanges;
+    BSP_SPINLOCK        change_lock;
     int                 active_total;
     int                 active_curr;
 };
@@ -144,6 +212,7 @@ BSP_DECLARE(int) bsp_del_event_container(BSP_EVENT_CONTAINER *ec);
 
 /**
  * Send notification to container
+ * Notify fd will be written only when container is blocked in wait and no notification pending
  *
  * @param BSP_EVENT_CONTAINER ec Container to notice
  *
@@ -151,6 +220,16 @@ BSP_DECLARE(int) bsp_del_event_container(BSP_EVENT_CONTAINER *ec);
  */
 BSP_DECLARE(int) bsp_poke_event_container(BSP_EVENT_CONTAINER *ec);
 
+/**
+ * Get poke counters of container
+ *
+ * @param BSP_EVENT_CONTAINER ec Target container
+ * @param BSP_EVENT_POKE_STAT stat Counters filled
+ *
+ * @return int Status
+ */
+BSP_DECLARE(int) bsp_poke_event_stat(BSP_EVENT_CONTAINER *ec, BSP_EVENT_POKE_STAT *stat);
+
 /**
  * Set (Add or modify) an event by given fd
  *
@@ -160,6 +239,29 @@ BSP_DECLARE(int) bsp_poke_event_container(BSP_EVENT_CONTAINER *ec);
  */
 BSP_DECLARE(int) bsp_set_event(int fd);
 
+/**
+ * Set events of a batch of fds, all registered into the same container.
+ * Called out of the loop thread of container, this costs one lock and one
+ * wakeup for the whole batch
+ *
+ * @param BSP_EVENT_CONTAINER ec Container of fds
+ * @param array fds File descriptors
+ * @param size_t nfds Number of fds
+ *
+ * @return size_t Number of events set
+ */
+BSP_DECLARE(size_t) bsp_set_event_batch(BSP_EVENT_CONTAINER *ec, const int *fds, size_t nfds);
+
+/**
+ * Re-arm an event, so an fd left ready (Edge triggered) will be reported by
+ * next wait of its container
+ *
+ * @param int fd File descriptor
+ *
+ * @return int Status
+ */
+BSP_DECLARE(int) bsp_rearm_event(int fd);
+
 /**
  * Add an event to container
  *
@@ -182,6 +284,9 @@ BSP_DECLARE(int) bsp_set_event(int fd);
 
 /**
  * Remove an event from container by given fd
+ * With IO_uring, completion-style IO of fd still in flight is cancelled too.
+ * Its buffers may be freed only after the completion (-ECANCELED if cancelled)
+ * was delivered to on_complete
  *
  * @param int fd File descriptor
  *
@@ -199,13 +304,61 @@ BSP_DECLARE(int) bsp_del_event(int fdv);
  */
 //BSP_DECLARE(int) bsp_wait_events(BSP_EVENT_CONTAINER *ec);
 
+/**
+ * Submit a completion-style read (IO_uring only)
+ * Result will be stored in event's read_result and on_complete called with BSP_EVENT_READ_COMPLETE
+ *
+ * @param int fd File descriptor, must be set into a container
+ * @param string buf Buffer to read into, must be kept until completion
+ * @param size_t len Length of buffer
+ *
+ * @return int Status
+ */
+BSP_DECLARE(int) bsp_submit_read(int fd, char *buf, size_t len);
+
+/**
+ * Submit a completion-style write (IO_uring only)
+ * Result will be stored in event's write_result and on_complete called with BSP_EVENT_WRITE_COMPLETE
+ *
+ * @param int fd File descriptor, must be set into a container
+ * @param string data Data to write, must be kept until completion
+ * @param size_t len Length of data
+ *
+ * @return int Status
+ */
+BSP_DECLARE(int) bsp_submit_write(int fd, const char *data, size_t len);
+
+/**
+ * Submit a completion-style accept (IO_uring only)
+ * New fd will be stored in event's read_result and on_complete called with BSP_EVENT_ACCEPT_COMPLETE
+ *
+ * @param int fd Server socket
+ * @param sockaddr addr Peer address, nullable
+ * @param socklen_t addrlen Length of address, nullable
+ *
+ * @return int Status
+ */
+BSP_DECLARE(int) bsp_submit_accept(int fd, struct sockaddr *addr, socklen_t *addrlen);
+
+/**
+ * Wait for active events and get all of them in one batch
+ * Triggered masks of returned fds are already decoded
+ * This call will blocked if no active event
+ *
+ * @param BSP_EVENT_CONTAINER ec Target container
+ * @param int total Number of active fds, nullable
+ *
+ * @return p List of active fds, owned by container and valid until next wait
+ */
+BSP_DECLARE(BSP_FD **) bsp_get_active_fds(BSP_EVENT_CONTAINER *ec, int *total);
+
 /**
  * Get appointed active event from container's event queue
+ * Fds are taken one by one from batch of bsp_get_active_fds()
  *
  * @param BSP_EVENT_CONTAINER ec Target container
- * @param int idx Index of queue, must less than _BSP_MAX_EVENTS
  *
- * @return int fd
+ * @return p BSP_FD
  */
 BSP_DECLARE(BSP_FD *) bsp_get_active_fd(BSP_EVENT_CONTAINER *ec);
 
@@ -43,14 +43,114 @@
 #include "bsp-private.h"
 #include "bsp.h"
 
-BSP_PRIVATE(BSP_FD) fd_list[_BSP_MAX_OPEN_FILES];
-BSP_SPINLOCK fd_lock = BSP_SPINLOCK_INITIALIZER;
+// Two-level table, segments allocated on first touch
+#define _FD_SEGMENTS                    (_BSP_MAX_OPEN_FILES >> _BSP_FD_SEGMENT_BITS)
+#define _FD_SEGMENT_BYTES               (sizeof(BSP_FD) * _BSP_FD_SEGMENT_SIZE)
+
+BSP_PRIVATE(BSP_FD *) fd_segments[_FD_SEGMENTS];
+
+// Slot of fd, create segment if required
+BSP_PRIVATE(BSP_FD *) _fd_slot(int fd, BSP_BOOLEAN create)
+{
+    size_t seg = (size_t) fd >> _BSP_FD_SEGMENT_BITS;
+    BSP_FD *segment = __atomic_load_n(&fd_segments[seg], __ATOMIC_ACQUIRE);
+    BSP_FD *empty = NULL;
+    if (!segment)
+    {
+        if (BSP_TRUE != create)
+        {
+            return NULL;
+        }
+
+        // Anonymous pages are zeroed by kernel
+        segment = mmap(NULL, _FD_SEGMENT_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == segment)
+        {
+            bsp_trace_message(BSP_TRACE_ERROR, "File", "Create fd segment failed");
+
+            return NULL;
+        }
+
+        if (!__atomic_compare_exchange_n(&fd_segments[seg], &empty, segment, BSP_FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            // Created by another thread
+            munmap(segment, _FD_SEGMENT_BYTES);
+            segment = empty;
+        }
+    }
+
+    return &segment[fd & (_BSP_FD_SEGMENT_SIZE - 1)];
+}
+
+/*
+ * Slots are rewritten in place while other threads may read them : writer hides
+ * slot (reg), rewrites fields, then publishes next generation. Reader takes
+ * generation before reading fields and checks it again after, like a seqlock
+ */
+BSP_PRIVATE(void) _fd_rewrite(BSP_FD *target, int fd, BSP_FD_TYPE type, void *ptr, uint32_t gen)
+{
+    __atomic_store_n(&target->reg, BSP_FALSE, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    target->fd = fd;
+    target->type = type;
+    target->state = 0;
+    target->ptr = ptr;
+    memset(&target->event, 0, sizeof(target->event));
+    memset(target->additions, 0, sizeof(target->additions));
+    __atomic_store_n(&target->gen, gen, __ATOMIC_RELEASE);
+
+    return;
+}
+
+// Slot still holds generation read before, fields read between are consistent
+BSP_PRIVATE(BSP_BOOLEAN) _fd_stable(BSP_FD *f, uint32_t gen)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    return (gen == __atomic_load_n(&f->gen, __ATOMIC_RELAXED) && 
+            BSP_TRUE == __atomic_load_n(&f->reg, __ATOMIC_RELAXED)) ? BSP_TRUE : BSP_FALSE;
+}
+
+// Registered slot matching type, gen taken before reading type
+BSP_PRIVATE(BSP_FD *) _fd_lookup(int fd, int type, BSP_BOOLEAN check_gen, uint32_t want)
+{
+    if (fd < 0 || fd >= _BSP_MAX_OPEN_FILES)
+    {
+        return NULL;
+    }
+
+    BSP_FD *f = _fd_slot(fd, BSP_FALSE);
+    if (!f)
+    {
+        return NULL;
+    }
+
+    uint32_t gen = __atomic_load_n(&f->gen, __ATOMIC_ACQUIRE);
+    if (BSP_TRUE != __atomic_load_n(&f->reg, __ATOMIC_ACQUIRE))
+    {
+        return NULL;
+    }
+
+    if (BSP_TRUE == check_gen && gen != want)
+    {
+        // Stale
+        return NULL;
+    }
+
+    int matched = (type == BSP_FD_ANY || type & f->type);
+    if (BSP_TRUE != _fd_stable(f, gen) || !matched)
+    {
+        // Rewritten while reading
+        return NULL;
+    }
+
+    return f;
+}
 
 // Initialization
 BSP_DECLARE(int) bsp_fd_init()
 {
-    bzero(fd_list, sizeof(BSP_FD) * _BSP_MAX_OPEN_FILES);
-
+    // Segments are created on demand, nothing to clear here
     return BSP_RTN_SUCCESS;
 }
 
@@ -63,14 +163,16 @@ BSP_DECLARE(BSP_FD *) bsp_reg_fd(int fd, BSP_FD_TYPE type, void *ptr)
     }
 
     // Just overwrite
-    BSP_FD *target = &fd_list[fd];
-    bsp_spin_lock(&fd_lock);
-    bzero(target, sizeof(BSP_FD));
-    target->fd = fd;
-    target->type = type;
-    target->ptr = ptr;
-    target->reg = BSP_TRUE;
-    bsp_spin_unlock(&fd_lock);
+    BSP_FD *target = _fd_slot(fd, BSP_TRUE);
+    if (!target)
+    {
+        return NULL;
+    }
+
+    // Lock-free : hide slot, rewrite it, then publish with next generation
+    uint32_t gen = __atomic_load_n(&target->gen, __ATOMIC_RELAXED);
+    _fd_rewrite(target, fd, type, ptr, gen + 1);
+    __atomic_store_n(&target->reg, BSP_TRUE, __ATOMIC_RELEASE);
 
     return target;
 }
@@ -83,11 +185,16 @@ BSP_DECLARE(int) bsp_unreg_fd(int fd)
         return BSP_RTN_INVALID;
     }
 
-    BSP_FD *target = &fd_list[fd];
-    bsp_spin_lock(&fd_lock);
-    bzero(target, sizeof(BSP_FD));
-    target->reg = BSP_FALSE;
-    bsp_spin_unlock(&fd_lock);
+    BSP_FD *target = _fd_slot(fd, BSP_FALSE);
+    if (!target)
+    {
+        // Never registered
+        return BSP_RTN_SUCCESS;
+    }
+
+    // Generation kept, old handles stay invalid after reuse
+    uint32_t gen = __atomic_load_n(&target->gen, __ATOMIC_RELAXED);
+    _fd_rewrite(target, fd, BSP_FD_UNKNOWN, NULL, gen);
 
     return BSP_RTN_SUCCESS;
 }
@@ -95,23 +202,24 @@ BSP_DECLARE(int) bsp_unreg_fd(int fd)
 // Get fd
 BSP_DECLARE(BSP_FD *) bsp_get_fd(int fd, int type)
 {
-    if (fd < 0 || fd >= _BSP_MAX_OPEN_FILES)
-    {
-        return NULL;
-    }
+    return _fd_lookup(fd, type, BSP_FALSE, 0);
+}
 
-    BSP_FD *f = &fd_list[fd];
-    if (BSP_FALSE == f->reg)
-    {
-        return NULL;
-    }
+// Get fd by handle
+BSP_DECLARE(BSP_FD *) bsp_get_fd_by_handle(BSP_FD_HANDLE handle, int type)
+{
+    return _fd_lookup(HANDLE_FD(handle), type, BSP_TRUE, (uint32_t) (handle >> 32));
+}
 
-    if (type == BSP_FD_ANY || type & f->type)
+// Check handle after fields were read
+BSP_DECLARE(BSP_BOOLEAN) bsp_fd_handle_valid(BSP_FD *f, BSP_FD_HANDLE handle)
+{
+    if (!f || HANDLE_FD(handle) != f->fd)
     {
-        return f;
+        return BSP_FALSE;
     }
 
-    return NULL;
+    return _fd_stable(f, (uint32_t) (handle >> 32));
 }
 
 // Bind addition
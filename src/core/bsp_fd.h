@@ -52,6 +52,8 @@
 #define FD_ADD_SET(fd, idx, ptr)        if (fd && (idx >= 0) && (idx < BSP_FD_ADDITIONS)) fd->additions[idx] = (void *) ptr
 #define FD_PTR(fd)                      (fd) ? (fd->ptr) : NULL
 #define FD_EVENT(fd)                    &fd->event
+#define FD_HANDLE(f)                    (((BSP_FD_HANDLE) (f)->gen << 32) | (uint32_t) (f)->fd)
+#define HANDLE_FD(handle)               ((int) ((handle) & 0xFFFFFFFF))
 
 /* Structs */
 
@@ -92,4 +94,26 @@ BSP_DECLARE(int) bsp_unreg_fd(int fd);
  */
 BSP_DECLARE(BSP_FD *) bsp_get_fd(int fd, int type);
 
+/**
+ * Get instance of fd by handle. Handle of an unregistered or reused fd will be rejected
+ *
+ * @param BSP_FD_HANDLE handle Handle, from FD_HANDLE()
+ * @param int type Type of fd, BSP_FD_ANY for any type
+ *
+ * @return p BSP_FD
+ */
+BSP_DECLARE(BSP_FD *) bsp_get_fd_by_handle(BSP_FD_HANDLE handle, int type);
+
+/**
+ * Check whether slot still belongs to handle. Slots are reused in place, call it
+ * after reading fields of a slot got by handle to make sure they were not
+ * rewritten by another registration meanwhile
+ *
+ * @param BSP_FD f Slot
+ * @param BSP_FD_HANDLE handle Handle the slot was got by
+ *
+ * @return bool BSP_TRUE if fields read before are valid
+ */
+BSP_DECLARE(BSP_BOOLEAN) bsp_fd_handle_valid(BSP_FD *f, BSP_FD_HANDLE handle);
+
 #endif  /* _CORE_BSP_FD_H */
@@ -33,9 +33,10 @@
  *
  * @package bsp::blacktail
  * @author Dr.NP <np@bsgroup.org>
- * @update 02/10/2015
+ * @update 10/18/2026
  * @changelog
  *      [02/10/2015] - Creation
+ *      [10/18/2026] - Per-thread magazine cache
  */
 
 #include "bsp-private.h"
@@ -43,6 +44,492 @@
 
 BSP_PRIVATE(const char *) _tag_ = "MemPool";
 
+BSP_PRIVATE(BSP_MEMPOOL *) pools[_BSP_MEMPOOL_MAX_CACHED];
+BSP_PRIVATE(int) pool_seq = 0;
+BSP_PRIVATE(BSP_SPINLOCK) pools_lock = BSP_SPINLOCK_INITIALIZER;
+BSP_PRIVATE(pthread_key_t) cache_key;
+BSP_PRIVATE(pthread_once_t) cache_key_once = PTHREAD_ONCE_INIT;
+BSP_PRIVATE(BSP_BOOLEAN) large_pages = BSP_FALSE;
+BSP_PRIVATE(BSP_BOOLEAN) thread_cache = BSP_TRUE;
+
+BSP_PRIVATE(void) _cache_destroy(void *arg);
+
+BSP_PRIVATE(void) _cache_key_create()
+{
+    pthread_key_create(&cache_key, _cache_destroy);
+
+    return;
+}
+
+// Slab header size, keep items cache line aligned
+#define _SLAB_HEADER                    ((sizeof(BSP_MEMPOOL_SLAB) + 63) & ~((size_t) 63))
+#define _SLAB_OF(m, item)               ((BSP_MEMPOOL_SLAB *) ((uintptr_t) (item) & ~((uintptr_t) (m)->slab_size - 1)))
+
+BSP_PRIVATE(void) _slab_list_add(BSP_MEMPOOL_SLAB **list, BSP_MEMPOOL_SLAB *s)
+{
+    s->prev = NULL;
+    s->next = *list;
+    if (*list)
+    {
+        (*list)->prev = s;
+    }
+
+    *list = s;
+
+    return;
+}
+
+BSP_PRIVATE(void) _slab_list_remove(BSP_MEMPOOL_SLAB **list, BSP_MEMPOOL_SLAB *s)
+{
+    if (s->prev)
+    {
+        s->prev->next = s->next;
+    }
+    else
+    {
+        *list = s->next;
+    }
+
+    if (s->next)
+    {
+        s->next->prev = s->prev;
+    }
+
+    s->prev = s->next = NULL;
+
+    return;
+}
+
+// Map a block aligned to its size
+BSP_PRIVATE(BSP_MEMPOOL_SLAB *) _slab_map(BSP_MEMPOOL *m)
+{
+    void *p = MAP_FAILED;
+    BSP_BOOLEAN huge = BSP_FALSE;
+    if (0 == m->total_slabs && !m->spare)
+    {
+        // Slab size fixed by the first slab
+        m->slab_size = (BSP_TRUE == large_pages) ? _BSP_MEMPOOL_HUGE_SLAB_SIZE : _BSP_MEMPOOL_SLAB_SIZE;
+    }
+
+    size_t size = m->slab_size;
+#ifdef MAP_HUGETLB
+    if (size >= _BSP_MEMPOOL_HUGE_SLAB_SIZE)
+    {
+        // Huge pages are naturally aligned
+        p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        huge = (MAP_FAILED != p) ? BSP_TRUE : BSP_FALSE;
+    }
+#endif
+    if (MAP_FAILED == p)
+    {
+        // Over-map and trim to alignment
+        char *raw = mmap(NULL, size * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == raw)
+        {
+            bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Mempool slab map failed");
+
+            return NULL;
+        }
+
+        char *aligned = (char *) (((uintptr_t) raw + size - 1) & ~((uintptr_t) size - 1));
+        if (aligned > raw)
+        {
+            munmap(raw, aligned - raw);
+        }
+
+        if (raw + size > aligned)
+        {
+            munmap(aligned + size, raw + size - aligned);
+        }
+
+        p = aligned;
+#ifdef MADV_HUGEPAGE
+        if (size >= _BSP_MEMPOOL_HUGE_SLAB_SIZE)
+        {
+            madvise(p, size, MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    BSP_MEMPOOL_SLAB *s = (BSP_MEMPOOL_SLAB *) p;
+    s->pool = m;
+    s->capacity = (size - _SLAB_HEADER) / m->slab_stride;
+    s->huge = huge;
+    m->total_slabs ++;
+
+    return s;
+}
+
+BSP_PRIVATE(void) _slab_unmap(BSP_MEMPOOL *m, BSP_MEMPOOL_SLAB *s)
+{
+    munmap((void *) s, m->slab_size);
+    m->total_slabs --;
+
+    return;
+}
+
+// Take one item from slabs, pool locked
+BSP_PRIVATE(void *) _slab_take(BSP_MEMPOOL *m)
+{
+    BSP_MEMPOOL_SLAB *s = m->partial;
+    void *item;
+    if (!s)
+    {
+        if (m->spare)
+        {
+            s = m->spare;
+            m->spare = NULL;
+        }
+        else
+        {
+            s = _slab_map(m);
+            if (!s)
+            {
+                return NULL;
+            }
+        }
+
+        _slab_list_add(&m->partial, s);
+    }
+
+    if (s->free_items)
+    {
+        item = s->free_items;
+        s->free_items = *(void **) item;
+    }
+    else
+    {
+        // Carve sequentially from a fresh area
+        item = (char *) s + _SLAB_HEADER + s->carved * m->slab_stride;
+        s->carved ++;
+    }
+
+    s->used ++;
+    m->misses ++;
+    if (s->used == s->capacity)
+    {
+        _slab_list_remove(&m->partial, s);
+        _slab_list_add(&m->full, s);
+    }
+
+    return item;
+}
+
+// Give one item back to its slab, pool locked
+BSP_PRIVATE(void) _slab_give(BSP_MEMPOOL *m, void *item)
+{
+    BSP_MEMPOOL_SLAB *s = _SLAB_OF(m, item);
+    *(void **) item = s->free_items;
+    s->free_items = item;
+    if (s->used == s->capacity)
+    {
+        _slab_list_remove(&m->full, s);
+        _slab_list_add(&m->partial, s);
+    }
+
+    s->used --;
+    m->releases ++;
+    if (0 == s->used)
+    {
+        _slab_list_remove(&m->partial, s);
+        if (!m->spare)
+        {
+            // Keep one empty slab against alloc / free thrashing
+            s->free_items = NULL;
+            s->carved = 0;
+            m->spare = s;
+        }
+        else
+        {
+            _slab_unmap(m, s);
+        }
+    }
+
+    return;
+}
+
+// New item from allocator
+BSP_PRIVATE(void *) _item_new(BSP_MEMPOOL *m)
+{
+    void *ret = NULL;
+    if (BSP_TRUE == m->slab)
+    {
+        bsp_spin_lock(&m->lock);
+        ret = _slab_take(m);
+        bsp_spin_unlock(&m->lock);
+        if (ret)
+        {
+            // Keep calloc() semantic for new items
+            memset(ret, 0, m->item_size);
+        }
+
+        return ret;
+    }
+
+    __atomic_add_fetch(&m->misses, 1, __ATOMIC_RELAXED);
+    if (m->allocator)
+    {
+        return m->allocator();
+    }
+
+    return bsp_calloc(1, m->item_size);
+}
+
+// Release item to system
+BSP_PRIVATE(void) _item_release(BSP_MEMPOOL *m, void *item)
+{
+    if (m && BSP_TRUE == m->slab)
+    {
+        bsp_spin_lock(&m->lock);
+        _slab_give(m, item);
+        bsp_spin_unlock(&m->lock);
+    }
+    else if (m && m->freer)
+    {
+        __atomic_add_fetch(&m->releases, 1, __ATOMIC_RELAXED);
+        m->freer(item);
+    }
+    else
+    {
+        if (m)
+        {
+            __atomic_add_fetch(&m->releases, 1, __ATOMIC_RELAXED);
+        }
+
+        bsp_free(item);
+    }
+
+    return;
+}
+
+// Release free items above keep, in batches out of pool lock
+BSP_PRIVATE(size_t) _depot_trim(BSP_MEMPOOL *m, size_t keep)
+{
+    void *batch[BSP_MEMPOOL_MAGAZINE_SIZE];
+    size_t n, i, total = 0;
+    do
+    {
+        n = 0;
+        bsp_spin_lock(&m->lock);
+        while (m->total_free > keep && n < BSP_MEMPOOL_MAGAZINE_SIZE)
+        {
+            batch[n ++] = m->free_list[-- m->total_free];
+        }
+
+        if (m->free_list_size > _BSP_MEMPOOL_FREE_LIST_SIZE && m->total_free < m->free_list_size / 4)
+        {
+            // Shrink free list
+            void **new_list = bsp_realloc(m->free_list, m->free_list_size / 2 * sizeof(void *));
+            if (new_list)
+            {
+                m->free_list = new_list;
+                m->free_list_size /= 2;
+            }
+        }
+
+        bsp_spin_unlock(&m->lock);
+        for (i = 0; i < n; i ++)
+        {
+            _item_release(m, batch[i]);
+        }
+
+        total += n;
+    } while (BSP_MEMPOOL_MAGAZINE_SIZE == n);
+
+    return total;
+}
+
+// Free list over high water
+BSP_PRIVATE(void) _depot_check_water(BSP_MEMPOOL *m)
+{
+    if (BSP_TRUE != m->slab && m->high_water > 0 && m->total_free > m->high_water)
+    {
+        _depot_trim(m, m->low_water);
+    }
+
+    return;
+}
+
+// Report thread counters to pool
+BSP_PRIVATE(void) _cache_account(BSP_MEMPOOL *m, BSP_MEMPOOL_CACHE *c)
+{
+    if (c->allocs)
+    {
+        __atomic_add_fetch(&m->allocs, c->allocs, __ATOMIC_RELAXED);
+        c->allocs = 0;
+    }
+
+    if (c->frees)
+    {
+        __atomic_add_fetch(&m->frees, c->frees, __ATOMIC_RELAXED);
+        c->frees = 0;
+    }
+
+    return;
+}
+
+// Take items from depot, pool locked
+BSP_PRIVATE(size_t) _depot_get(BSP_MEMPOOL *m, void **items, size_t nitems)
+{
+    size_t n = 0;
+    if (BSP_TRUE == m->slab)
+    {
+        // Items carved in order, neighbours stay close
+        while (n < nitems)
+        {
+            items[n] = _slab_take(m);
+            if (!items[n])
+            {
+                break;
+            }
+
+            memset(items[n], 0, m->item_size);
+            n ++;
+        }
+
+        return n;
+    }
+
+    n = (m->total_free > nitems) ? nitems : m->total_free;
+    m->total_free -= n;
+    memcpy(items, m->free_list + m->total_free, n * sizeof(void *));
+
+    return n;
+}
+
+// Push items to depot, pool locked
+BSP_PRIVATE(size_t) _depot_put(BSP_MEMPOOL *m, void **items, size_t nitems)
+{
+    size_t i;
+    if (BSP_TRUE == m->slab)
+    {
+        for (i = 0; i < nitems; i ++)
+        {
+            _slab_give(m, items[i]);
+        }
+
+        return nitems;
+    }
+
+    while (m->total_free + nitems > m->free_list_size)
+    {
+        // Enlarge free list
+        void **new_list = bsp_realloc(m->free_list, m->free_list_size * 2 * sizeof(void *));
+        if (new_list)
+        {
+            m->free_list = new_list;
+            m->free_list_size *= 2;
+        }
+        else
+        {
+            bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Mempool free list realloc failed");
+
+            return 0;
+        }
+    }
+
+    memcpy(m->free_list + m->total_free, items, nitems * sizeof(void *));
+    m->total_free += nitems;
+
+    return nitems;
+}
+
+// Get cache of pool for current thread, NULL if pool not cacheable
+BSP_PRIVATE(BSP_MEMPOOL_CACHE *) _get_cache(BSP_MEMPOOL *m)
+{
+    if (m->id < 0)
+    {
+        return NULL;
+    }
+
+    BSP_MEMPOOL_CACHE **caches = (BSP_MEMPOOL_CACHE **) pthread_getspecific(cache_key);
+    if (!caches)
+    {
+        caches = bsp_calloc(_BSP_MEMPOOL_MAX_CACHED, sizeof(BSP_MEMPOOL_CACHE *));
+        if (!caches)
+        {
+            return NULL;
+        }
+
+        pthread_setspecific(cache_key, caches);
+    }
+
+    BSP_MEMPOOL_CACHE *c = caches[m->id];
+    if (!c)
+    {
+        c = bsp_calloc(1, sizeof(BSP_MEMPOOL_CACHE));
+        if (!c)
+        {
+            return NULL;
+        }
+
+        c->loaded = &c->mags[0];
+        c->previous = &c->mags[1];
+        c->slab = m->slab;
+        caches[m->id] = c;
+    }
+
+    return c;
+}
+
+// Return all cached items of one pool, pools_lock held
+BSP_PRIVATE(void) _cache_drain(BSP_MEMPOOL *m, BSP_MEMPOOL_CACHE *c)
+{
+    BSP_MEMPOOL_MAGAZINE *mag;
+    size_t i, j, put;
+    for (i = 0; i < 2; i ++)
+    {
+        mag = &c->mags[i];
+        put = 0;
+        if (m && mag->rounds > 0)
+        {
+            bsp_spin_lock(&m->lock);
+            put = _depot_put(m, mag->items, mag->rounds);
+            bsp_spin_unlock(&m->lock);
+        }
+
+        for (j = put; j < mag->rounds && (m || BSP_TRUE != c->slab); j ++)
+        {
+            // Slabs of deleted pool already unmapped
+            _item_release(m, mag->items[j]);
+        }
+
+        mag->rounds = 0;
+    }
+
+    if (m)
+    {
+        _cache_account(m, c);
+        _depot_check_water(m);
+    }
+
+    return;
+}
+
+// Thread exit
+BSP_PRIVATE(void) _cache_destroy(void *arg)
+{
+    BSP_MEMPOOL_CACHE **caches = (BSP_MEMPOOL_CACHE **) arg;
+    int i;
+    if (caches)
+    {
+        bsp_spin_lock(&pools_lock);
+        for (i = 0; i < _BSP_MEMPOOL_MAX_CACHED; i ++)
+        {
+            if (caches[i])
+            {
+                _cache_drain(pools[i], caches[i]);
+                bsp_free(caches[i]);
+            }
+        }
+
+        bsp_spin_unlock(&pools_lock);
+        bsp_free(caches);
+    }
+
+    return;
+}
+
 // Generate a new pool
 BSP_DECLARE(BSP_MEMPOOL *) bsp_new_mempool(size_t item_size, void * (*allocator)(), void (freer) (void *))
 {
@@ -59,8 +546,29 @@ BSP_DECLARE(BSP_MEMPOOL *) bsp_new_mempool(size_t item_size, void * (*allocator)
         }
 
         m->free_list_size = _BSP_MEMPOOL_FREE_LIST_SIZE;
+        m->low_water = _BSP_MEMPOOL_LOW_WATER;
         m->item_size = item_size;
         bsp_spin_init(&m->lock);
+
+        // Ids never reused, pools beyond limit work without thread cache
+        pthread_once(&cache_key_once, _cache_key_create);
+        bsp_spin_lock(&pools_lock);
+        if (BSP_TRUE == thread_cache && pool_seq < _BSP_MEMPOOL_MAX_CACHED)
+        {
+            m->id = pool_seq ++;
+            pools[m->id] = m;
+        }
+        else
+        {
+            m->id = -1;
+        }
+
+        bsp_spin_unlock(&pools_lock);
+#ifdef ENABLE_LOCK_PROFILE
+        char name[_BSP_LOCK_NAME_LENGTH];
+        snprintf(name, _BSP_LOCK_NAME_LENGTH, "mempool %d (%zu bytes)", m->id, item_size);
+        bsp_spin_set_name(&m->lock, name);
+#endif
         if (allocator)
         {
             m->allocator = allocator;
@@ -70,6 +578,12 @@ BSP_DECLARE(BSP_MEMPOOL *) bsp_new_mempool(size_t item_size, void * (*allocator)
         {
             m->freer = freer;
         }
+
+        if (!allocator && !freer && item_size <= _BSP_MEMPOOL_SLAB_ITEM_MAX)
+        {
+            m->slab = BSP_TRUE;
+            m->slab_stride = (item_size < sizeof(void *)) ? sizeof(void *) : (item_size + 15) & ~((size_t) 15);
+        }
     }
     else
     {
@@ -85,26 +599,55 @@ BSP_DECLARE(void) bsp_del_mempool(BSP_MEMPOOL *m)
     if (m)
     {
         size_t i;
+        BSP_MEMPOOL_CACHE *c = _get_cache(m);
+        bsp_spin_lock(&pools_lock);
+        if (c)
+        {
+            _cache_drain(m, c);
+        }
+
+        if (m->id >= 0)
+        {
+            // Caches of other threads release items by bsp_free() on exit
+            pools[m->id] = NULL;
+        }
+
+        bsp_spin_unlock(&pools_lock);
         bsp_spin_lock(&m->lock);
-        // Free each item
-        if (m->freer)
+        if (BSP_TRUE == m->slab)
         {
-            // With defined freer
-            for (i = 0; i < m->total_free; i ++)
+            // Items in use are gone with their slabs
+            BSP_MEMPOOL_SLAB *s;
+            while ((s = m->partial))
+            {
+                _slab_list_remove(&m->partial, s);
+                _slab_unmap(m, s);
+            }
+
+            while ((s = m->full))
             {
-                m->freer(m->free_list[i]);
+                _slab_list_remove(&m->full, s);
+                _slab_unmap(m, s);
+            }
+
+            if (m->spare)
+            {
+                _slab_unmap(m, m->spare);
+                m->spare = NULL;
             }
         }
         else
         {
-            // With bsp_free()
+            // Free each item
             for (i = 0; i < m->total_free; i ++)
             {
-                bsp_free(m->free_list[i]);
+                _item_release(m, m->free_list[i]);
             }
         }
 
         bsp_spin_unlock(&m->lock);
+        bsp_spin_set_name(&m->lock, NULL);
+        bsp_free(m->free_list);
         bsp_free(m);
     }
 
@@ -115,28 +658,49 @@ BSP_DECLARE(void) bsp_del_mempool(BSP_MEMPOOL *m)
 BSP_DECLARE(void *) bsp_mempool_alloc(BSP_MEMPOOL *m)
 {
     void *ret = NULL;
+    BSP_MEMPOOL_MAGAZINE *mag;
+    size_t n;
     if (m)
     {
-        bsp_spin_lock(&m->lock);
-        if (m->total_free > 0)
+        BSP_MEMPOOL_CACHE *c = _get_cache(m);
+        if (c)
         {
-            ret = m->free_list[-- m->total_free];
-        }
+            if (0 == c->loaded->rounds && c->previous->rounds > 0)
+            {
+                mag = c->loaded;
+                c->loaded = c->previous;
+                c->previous = mag;
+            }
 
-        if (!ret)
-        {
-            // Generate a new one
-            if (m->allocator)
+            if (0 == c->loaded->rounds)
             {
-                ret = m->allocator();
+                // Both empty, refill loaded from depot in one batch
+                mag = c->loaded;
+                bsp_spin_lock(&m->lock);
+                n = _depot_get(m, mag->items, BSP_MEMPOOL_MAGAZINE_SIZE);
+                bsp_spin_unlock(&m->lock);
+                mag->rounds = n;
+                _cache_account(m, c);
             }
-            else
+
+            c->allocs ++;
+            if (c->loaded->rounds > 0)
             {
-                ret = bsp_calloc(1, m->item_size);
+                return c->loaded->items[-- c->loaded->rounds];
             }
+
+            return _item_new(m);
         }
 
+        __atomic_add_fetch(&m->allocs, 1, __ATOMIC_RELAXED);
+        bsp_spin_lock(&m->lock);
+        _depot_get(m, &ret, 1);
         bsp_spin_unlock(&m->lock);
+        if (!ret)
+        {
+            // Generate a new one
+            ret = _item_new(m);
+        }
     }
 
     return ret;
@@ -145,29 +709,198 @@ BSP_DECLARE(void *) bsp_mempool_alloc(BSP_MEMPOOL *m)
 // Free (return back) an item to pool
 BSP_DECLARE(void) bsp_mempool_free(BSP_MEMPOOL *m, void *item)
 {
+    BSP_MEMPOOL_MAGAZINE *mag;
     if (m)
     {
-        bsp_spin_lock(&m->lock);
-        while (m->total_free >= m->free_list_size)
+        BSP_MEMPOOL_CACHE *c = _get_cache(m);
+        if (c)
         {
-            // Enlarge free list
-            void **new_list = bsp_realloc(m->free_list, m->free_list_size * 2 * sizeof(void *));
-            if (new_list)
+            if (c->loaded->rounds >= BSP_MEMPOOL_MAGAZINE_SIZE)
             {
-                m->free_list = new_list;
-                m->free_list_size *= 2;
+                mag = c->loaded;
+                c->loaded = c->previous;
+                c->previous = mag;
             }
-            else
+
+            if (c->loaded->rounds >= BSP_MEMPOOL_MAGAZINE_SIZE)
             {
-                bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Mempool free list realloc failed");
+                // Both full, move loaded to depot in one batch
+                mag = c->loaded;
+                bsp_spin_lock(&m->lock);
+                if (_depot_put(m, mag->items, mag->rounds) > 0)
+                {
+                    mag->rounds = 0;
+                }
+
                 bsp_spin_unlock(&m->lock);
+                _cache_account(m, c);
+                _depot_check_water(m);
+            }
 
-                return;
+            c->frees ++;
+
+            if (c->loaded->rounds < BSP_MEMPOOL_MAGAZINE_SIZE)
+            {
+                c->loaded->items[c->loaded->rounds ++] = item;
+            }
+            else
+            {
+                _item_release(m, item);
             }
+
+            return;
         }
 
-        m->free_list[m->total_free ++] = item;
+        __atomic_add_fetch(&m->frees, 1, __ATOMIC_RELAXED);
+        bsp_spin_lock(&m->lock);
+        size_t put = _depot_put(m, &item, 1);
         bsp_spin_unlock(&m->lock);
+        if (0 == put)
+        {
+            _item_release(m, item);
+        }
+        else
+        {
+            _depot_check_water(m);
+        }
+    }
+
+    return;
+}
+
+// Water marks
+BSP_DECLARE(void) bsp_mempool_set_water(BSP_MEMPOOL *m, size_t high, size_t low)
+{
+    if (m)
+    {
+        bsp_spin_lock(&m->lock);
+        m->high_water = high;
+        m->low_water = (high > 0 && low > high) ? high : low;
+        bsp_spin_unlock(&m->lock);
+        _depot_check_water(m);
+    }
+
+    return;
+}
+
+// Trim pool
+BSP_DECLARE(size_t) bsp_mempool_trim(BSP_MEMPOOL *m)
+{
+    size_t ret = 0;
+    if (m)
+    {
+        if (BSP_TRUE == m->slab)
+        {
+            // Free items live in slabs, only spare slab held
+            bsp_spin_lock(&m->lock);
+            if (m->spare)
+            {
+                _slab_unmap(m, m->spare);
+                m->spare = NULL;
+                ret = 1;
+            }
+
+            bsp_spin_unlock(&m->lock);
+        }
+        else
+        {
+            ret = _depot_trim(m, m->low_water);
+        }
+    }
+
+    return ret;
+}
+
+// Trim all pools
+BSP_DECLARE(size_t) bsp_mempool_trim_all()
+{
+    size_t ret = 0;
+    int i;
+    bsp_spin_lock(&pools_lock);
+    for (i = 0; i < pool_seq; i ++)
+    {
+        if (pools[i])
+        {
+            ret += bsp_mempool_trim(pools[i]);
+        }
+    }
+
+    bsp_spin_unlock(&pools_lock);
+    if (ret > 0)
+    {
+        bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "%llu items trimmed from mempools", (unsigned long long) ret);
+    }
+
+    return ret;
+}
+
+// Counters
+BSP_DECLARE(int) bsp_mempool_stat(BSP_MEMPOOL *m, BSP_MEMPOOL_STAT *stat)
+{
+    if (!m || !stat)
+    {
+        return BSP_RTN_INVALID;
+    }
+
+    bzero(stat, sizeof(BSP_MEMPOOL_STAT));
+    bsp_spin_lock(&m->lock);
+    stat->allocs = __atomic_load_n(&m->allocs, __ATOMIC_RELAXED);
+    stat->frees = __atomic_load_n(&m->frees, __ATOMIC_RELAXED);
+    stat->misses = __atomic_load_n(&m->misses, __ATOMIC_RELAXED);
+    stat->releases = __atomic_load_n(&m->releases, __ATOMIC_RELAXED);
+    stat->hits = (stat->allocs > stat->misses) ? stat->allocs - stat->misses : 0;
+    stat->in_use = (stat->allocs > stat->frees) ? stat->allocs - stat->frees : 0;
+    // Items held by pool, in use or cached
+    size_t held = (stat->misses > stat->releases) ? stat->misses - stat->releases : 0;
+    stat->cached = (held > stat->in_use) ? held - stat->in_use : 0;
+    if (BSP_TRUE == m->slab)
+    {
+        stat->bytes = m->total_slabs * m->slab_size;
+    }
+    else
+    {
+        stat->bytes = held * m->item_size + m->free_list_size * sizeof(void *);
+    }
+
+    bsp_spin_unlock(&m->lock);
+
+    return BSP_RTN_SUCCESS;
+}
+
+// Huge page slabs
+BSP_DECLARE(void) bsp_mempool_large_pages(BSP_BOOLEAN enable)
+{
+    large_pages = enable;
+
+    return;
+}
+
+// Per-thread magazines
+BSP_DECLARE(void) bsp_mempool_thread_cache(BSP_BOOLEAN enable)
+{
+    thread_cache = enable;
+
+    return;
+}
+
+// Flush caches of current thread
+BSP_DECLARE(void) bsp_mempool_flush_cache()
+{
+    pthread_once(&cache_key_once, _cache_key_create);
+    BSP_MEMPOOL_CACHE **caches = (BSP_MEMPOOL_CACHE **) pthread_getspecific(cache_key);
+    int i;
+    if (caches)
+    {
+        bsp_spin_lock(&pools_lock);
+        for (i = 0; i < _BSP_MEMPOOL_MAX_CACHED; i ++)
+        {
+            if (caches[i])
+            {
+                _cache_drain(pools[i], caches[i]);
+            }
+        }
+
+        bsp_spin_unlock(&pools_lock);
     }
 
     return;
@@ -33,9 +33,10 @@
  *
  * @package bsp::blacktail
  * @author Dr.NP <np@bsgroup.org>
- * @update 02/10/2015
+ * @update 10/18/2026
  * @changelog
  *      [02/10/2015] - Creation
+ *      [10/18/2026] - Per-thread magazine cache
  */
 
 #ifndef _CORE_BSP_ALLOC_H
@@ -44,17 +45,85 @@
 /* Headers */
 
 /* Definations */
+#define BSP_MEMPOOL_MAGAZINE_SIZE       64
+
+// Aligned block items carved from, header at the head of block
+typedef struct bsp_mempool_slab_t
+{
+    struct bsp_mempool_t
+                        *pool;
+    struct bsp_mempool_slab_t
+                        *prev;
+    struct bsp_mempool_slab_t
+                        *next;
+    void                *free_items;
+    size_t              used;
+    size_t              carved;
+    size_t              capacity;
+    BSP_BOOLEAN         huge;
+} BSP_MEMPOOL_SLAB;
+
 typedef struct bsp_mempool_t
 {
     ssize_t             item_size;
+    int                 id;
     void                **free_list;
     size_t              free_list_size;
     size_t              total_free;
+    BSP_BOOLEAN         slab;
+    size_t              slab_size;
+    size_t              slab_stride;
+    size_t              total_slabs;
+    BSP_MEMPOOL_SLAB    *partial;
+    BSP_MEMPOOL_SLAB    *full;
+    BSP_MEMPOOL_SLAB    *spare;
+    size_t              high_water;
+    size_t              low_water;
+
+    // Counters
+    uint64_t            allocs;
+    uint64_t            frees;
+    uint64_t            misses;
+    uint64_t            releases;
     void                *(* allocator) ();
     void                (* freer) (void *);
     BSP_SPINLOCK        lock;
 } BSP_MEMPOOL;
 
+// Thread-local stack of free items
+typedef struct bsp_mempool_magazine_t
+{
+    size_t              rounds;
+    void                *items[BSP_MEMPOOL_MAGAZINE_SIZE];
+} BSP_MEMPOOL_MAGAZINE;
+
+// Per-thread cache of one pool : loaded and previous magazine
+typedef struct bsp_mempool_cache_t
+{
+    BSP_MEMPOOL_MAGAZINE
+                        *loaded;
+    BSP_MEMPOOL_MAGAZINE
+                        *previous;
+    BSP_MEMPOOL_MAGAZINE
+                        mags[2];
+    BSP_BOOLEAN         slab;
+    uint64_t            allocs;
+    uint64_t            frees;
+} BSP_MEMPOOL_CACHE;
+
+// Snapshot of pool counters. Thread caches report in magazine batches
+typedef struct bsp_mempool_stat_t
+{
+    uint64_t            allocs;
+    uint64_t            frees;
+    uint64_t            hits;
+    uint64_t            misses;
+    uint64_t            releases;
+    size_t              in_use;
+    size_t              cached;
+    size_t              bytes;
+} BSP_MEMPOOL_STAT;
+
 /* Macros */
 
 /* Strcuts */
@@ -62,6 +131,7 @@ typedef struct bsp_mempool_t
 /* Functions */
 /**
  * Generate a new memory pool
+ * Without allocator and freer, items are carved from aligned slabs, and empty slabs return to system
  *
  * @param size_t item_size Length of item
  * @param callable allocator Allocator for item, if NULL, bsp_calloc() will be used
@@ -73,7 +143,8 @@ BSP_DECLARE(BSP_MEMPOOL *) bsp_new_mempool(size_t item_size, void * (*_allocator
 
 /**
  * Delete a memory pool
- * All items in free list will be freed
+ * All items in free list and in cache of current thread will be freed.
+ * Other threads must not use the pool any more
  *
  * @param BSP_MEMPOOL m Pool to delete
  *
@@ -100,4 +171,71 @@ BSP_DECLARE(void *) bsp_mempool_alloc(BSP_MEMPOOL *m);
  */
 BSP_DECLARE(void) bsp_mempool_free(BSP_MEMPOOL *m, void *item);
 
+/**
+ * Return all items cached by current thread back to their pools.
+ * Called automatically when thread exits
+ *
+ * @return void
+ */
+BSP_DECLARE(void) bsp_mempool_flush_cache();
+
+/**
+ * Set water marks of pool free list.
+ * Once free items exceed high water, they are released down to low water.
+ * Trimming always keeps low water
+ *
+ * @param BSP_MEMPOOL m Pool
+ * @param size_t high High water, 0 for unlimited
+ * @param size_t low Low water
+ *
+ * @return void
+ */
+BSP_DECLARE(void) bsp_mempool_set_water(BSP_MEMPOOL *m, size_t high, size_t low);
+
+/**
+ * Release free items above low water (and spare slab) to system
+ *
+ * @param BSP_MEMPOOL m Pool
+ *
+ * @return size_t Items released
+ */
+BSP_DECLARE(size_t) bsp_mempool_trim(BSP_MEMPOOL *m);
+
+/**
+ * Trim all pools. Called by BOSS thread periodically
+ *
+ * @return size_t Items released
+ */
+BSP_DECLARE(size_t) bsp_mempool_trim_all();
+
+/**
+ * Get counters of pool
+ *
+ * @param BSP_MEMPOOL m Pool
+ * @param BSP_MEMPOOL_STAT stat Result
+ *
+ * @return int Status
+ */
+BSP_DECLARE(int) bsp_mempool_stat(BSP_MEMPOOL *m, BSP_MEMPOOL_STAT *stat);
+
+/**
+ * Back slabs with huge pages (MAP_HUGETLB, or MADV_HUGEPAGE as fallback).
+ * Only affects pools which have not mapped any slab yet
+ *
+ * @param BSP_BOOLEAN enable Switch
+ *
+ * @return void
+ */
+BSP_DECLARE(void) bsp_mempool_large_pages(BSP_BOOLEAN enable);
+
+/**
+ * Switch per-thread magazine cache.
+ * Only affects pools created afterwards, others keep their mode
+ *
+ * @param BSP_BOOLEAN enable Switch
+ *
+ * @return void
+ */
+BSP_DECLARE(void) bsp_mempool_thread_cache(BSP_BOOLEAN enable);
+
 #endif  /* _CORE_BSP_ALLOC_H */
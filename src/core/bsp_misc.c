@@ -255,6 +255,12 @@ BSP_DECLARE(int) bsp_enable_large_pages()
 
         return BSP_RTN_ERR_MEMORY;
     }
+#elif defined(OS_LINUX)
+    // Mempool slabs will be mapped with huge pages
+    bsp_mempool_large_pages(BSP_TRUE);
+    bsp_trace_message(BSP_TRACE_INFORMATIONAL, "System", "Mempool slabs use huge pages");
+
+    return BSP_RTN_SUCCESS;
 #else
     bsp_trace_message(BSP_TRACE_WARNING, "System", "HugeTLB not supported on this system");
 
@@ -79,6 +79,10 @@ BSP_DECLARE(int) bsp_thread_init()
     return BSP_RTN_SUCCESS;
 }
 
+#define _EVENT_MASK_COMPLETE            (BSP_EVENT_READ_COMPLETE | BSP_EVENT_WRITE_COMPLETE | BSP_EVENT_ACCEPT_COMPLETE)
+#define _EVENT_MASK_NON_SOCKET          (BSP_EVENT_SIGNAL | BSP_EVENT_TIMER | BSP_EVENT_EVENT | _EVENT_MASK_COMPLETE)
+#define _EVENT_MASK_SOCKET              (BSP_EVENT_READ | BSP_EVENT_WRITE | BSP_EVENT_ACCEPT | BSP_EVENT_LOCAL_HUP | BSP_EVENT_REMOTE_HUP | BSP_EVENT_ERROR)
+
 BSP_PRIVATE(void *) _process(void *arg)
 {
     BSP_THREAD *me = (BSP_THREAD *) arg;
@@ -87,10 +91,12 @@ BSP_PRIVATE(void *) _process(void *arg)
         return NULL;
     }
 
+    BSP_FD **fds = NULL;
     BSP_FD *f = NULL;
     BSP_EVENT_SPEC *ev = NULL;
     BSP_SOCKET *sck = NULL;
-    BSP_TIMER *tmr = NULL;
+    int nfds = 0, i, triggered;
+    BSP_BOOLEAN timer_hit;
     pthread_setspecific(lid_key, arg);
 
     // Condition signal
@@ -107,94 +113,123 @@ BSP_PRIVATE(void *) _process(void *arg)
 
     while (me->has_loop)
     {
-        f = bsp_get_active_fd(me->event_container);
-        if (f)
+        fds = bsp_get_active_fds(me->event_container, &nfds);
+        timer_hit = BSP_FALSE;
+        for (i = 0; i < nfds; i ++)
         {
+            f = fds[i];
             ev = FD_EVENT(f);
-            bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Event %d triggered on fd %d", ev->triggered, f->fd);
-            sck = NULL;
+            triggered = ev->triggered;
+            bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Event %d triggered on fd %d", triggered, f->fd);
 
             // Non socket
-            if (ev->triggered & BSP_EVENT_SIGNAL)
+            if (triggered & _EVENT_MASK_NON_SOCKET)
             {
-                // Signal
-                bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Signal event triggered");
-            }
+                if (triggered & BSP_EVENT_SIGNAL)
+                {
+                    // Signal
+                    bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Signal event triggered");
+                }
 
-            if (ev->triggered & BSP_EVENT_TIMER)
-            {
-                // Timer
-                bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Timer event triggered");
-                tmr = (BSP_TIMER *) f->ptr;
-                if (tmr)
+                if (triggered & BSP_EVENT_TIMER)
                 {
-                    bsp_trigger_timer(tmr);
+                    // Timer fd
+                    bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Timer event triggered");
+                    timer_hit = BSP_TRUE;
                 }
-            }
 
-            if (ev->triggered & BSP_EVENT_EVENT)
-            {
-                // Event
-                bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Notification event triggered");
-                if (me->hook_notify)
+                if (triggered & BSP_EVENT_EVENT)
                 {
-                    me->hook_notify(me);
+                    // Event
+                    bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Notification event triggered");
+                    if (me->hook_notify)
+                    {
+                        me->hook_notify(me);
+                    }
+                }
+
+                if (triggered & _EVENT_MASK_COMPLETE && ev->on_complete)
+                {
+                    // Completion-style IO finished
+                    bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "IO completed on fd %d", f->fd);
+                    ev->on_complete(f);
                 }
             }
 
             // Socket
-            if (ev->triggered & BSP_EVENT_READ)
+            if (!(triggered & _EVENT_MASK_SOCKET))
+            {
+                continue;
+            }
+
+            sck = (BSP_SOCKET *) f->ptr;
+            if (!sck)
+            {
+                continue;
+            }
+
+            if (BSP_FD_PIPE == f->type)
+            {
+                // Pipe queued to socket by bsp_socket_append_file() got data (or closed)
+                bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Pipe %d of socket %d ready", f->fd, sck->fd);
+                sck->state |= BSP_SOCK_STATE_WRITABLE;
+                bsp_drive_socket(sck);
+
+                continue;
+            }
+
+            if (triggered & BSP_EVENT_READ)
             {
                 // Data can read
                 bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "FD %d become readable", f->fd);
-                sck = (BSP_SOCKET *) f->ptr;
                 sck->state |= BSP_SOCK_STATE_READABLE;
             }
 
-            if (ev->triggered & BSP_EVENT_WRITE)
+            if (triggered & BSP_EVENT_WRITE)
             {
                 // IO writable
                 bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "FD %d become writable", f->fd);
-                sck = (BSP_SOCKET *) f->ptr;
                 sck->state |= BSP_SOCK_STATE_WRITABLE;
             }
 
-            if (ev->triggered & BSP_EVENT_ACCEPT)
+            if (triggered & BSP_EVENT_ACCEPT)
             {
                 // TCP / SCTP acceptable
                 bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "FD %d become acceptable", f->fd);
-                sck = (BSP_SOCKET *) f->ptr;
                 sck->state |= BSP_SOCK_STATE_ACCEPTABLE;
             }
 
-            if (ev->triggered & BSP_EVENT_LOCAL_HUP)
+            if (triggered & (BSP_EVENT_LOCAL_HUP | BSP_EVENT_REMOTE_HUP))
             {
-                // Local hup
-                bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "FD %d hup locally", f->fd);
-                sck = (BSP_SOCKET *) f->ptr;
+                // Local / remote hup
+                bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "FD %d hup", f->fd);
                 sck->state = BSP_SOCK_STATE_ERROR | BSP_SOCK_STATE_CLOSE;
             }
 
-            if (ev->triggered & BSP_EVENT_REMOTE_HUP)
-            {
-                // Remote hup
-                bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "FD %d hup remotely", f->fd);
-                sck = (BSP_SOCKET *) f->ptr;
-                sck->state = BSP_SOCK_STATE_ERROR | BSP_SOCK_STATE_CLOSE;
-            }
-
-            if (ev->triggered & BSP_EVENT_ERROR)
+            if ((triggered & BSP_EVENT_ERROR) && !bsp_socket_zerocopy_complete(sck))
             {
                 // General error
                 bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "FD %d triggered an error", f->fd);
-                sck = (BSP_SOCKET *) f->ptr;
                 sck->state = BSP_SOCK_STATE_ERROR | BSP_SOCK_STATE_PRECLOSE;
             }
 
-            if (sck)
-            {
-                bsp_drive_socket(sck);
-            }
+            bsp_drive_socket(sck);
+        }
+
+        // Closed sockets waiting for zero copy completions
+        bsp_socket_reap_orphans();
+
+        // Timing wheel
+        if (bsp_run_timers(me->event_container) > 0)
+        {
+            bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Timer event triggered");
+            timer_hit = BSP_TRUE;
+        }
+
+        // Once per pass, whether timer fd or timing wheel fired
+        if (timer_hit && me->hook_timer)
+        {
+            me->hook_timer(me);
         }
     }
 
@@ -204,6 +239,9 @@ BSP_PRIVATE(void *) _process(void *arg)
         (me->hook_latter)(me);
     }
 
+    bsp_del_arena(me->arena);
+    me->arena = NULL;
+
     return NULL;
 }
 
@@ -478,3 +516,46 @@ BSP_DECLARE(BSP_THREAD *) bsp_self_thread()
 
     return t;
 }
+
+// Pin thread to CPU
+BSP_DECLARE(int) bsp_thread_bind_cpu(BSP_THREAD *t, int cpu)
+{
+    if (!t || cpu < 0)
+    {
+        return BSP_RTN_INVALID;
+    }
+
+#ifdef OS_LINUX
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET((ncpus > 0) ? cpu % ncpus : cpu, &set);
+    if (0 != pthread_setaffinity_np(t->pid, sizeof(cpu_set_t), &set))
+    {
+        bsp_trace_message(BSP_TRACE_WARNING, _tag_, "Bind thread %d to CPU %d failed", t->id, cpu);
+
+        return BSP_RTN_ERR_THREAD;
+    }
+
+    return BSP_RTN_SUCCESS;
+#else
+    return BSP_RTN_INVALID;
+#endif
+}
+
+// Arena of current thread
+BSP_DECLARE(BSP_ARENA *) bsp_thread_arena()
+{
+    BSP_THREAD *t = bsp_self_thread();
+    if (!t)
+    {
+        return NULL;
+    }
+
+    if (!t->arena)
+    {
+        t->arena = bsp_new_arena(0);
+    }
+
+    return t->arena;
+}
@@ -81,6 +81,8 @@ typedef struct bsp_thread_t
     // Hook when notify triggered
     void                (*hook_notify)(struct bsp_thread_t *);
     BSP_BOOLEAN         has_loop;
+    // Request-scoped arena, reset after each on_data
+    struct bsp_arena_t  *arena;
     // Additional data
     void                *additional;
 } BSP_THREAD;
@@ -174,4 +176,22 @@ BSP_DECLARE(BSP_THREAD *) bsp_get_thread(BSP_THREAD_TYPE type, int idx);
  */
 BSP_DECLARE(BSP_THREAD *) bsp_self_thread();
 
+/**
+ * Pin thread to one CPU (Linux only)
+ *
+ * @param BSP_THREAD t Thread
+ * @param int cpu CPU index, wrapped by number of online CPUs
+ *
+ * @return int Status
+ */
+BSP_DECLARE(int) bsp_thread_bind_cpu(BSP_THREAD *t, int cpu);
+
+/**
+ * Return arena of current thread, created on first call.
+ * Arena of IO thread is reset after each on_data callback returns
+ *
+ * @return p BSP_ARENA, NULL if not called in a BSP thread
+ */
+BSP_DECLARE(struct bsp_arena_t *) bsp_thread_arena();
+
 #endif  /* _CORE_BSP_THREAD_H */
@@ -41,7 +41,41 @@
 #include "bsp-private.h"
 #include "bsp.h"
 
+#ifdef OS_LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
 BSP_PRIVATE(struct timespec) ts = {0, 500000};
+BSP_PRIVATE(uint32_t) ncpus = 0;
+
+#ifdef ENABLE_LOCK_PROFILE
+// Counters of one (site, lock) pair, slot claimed by lock then published by site
+typedef struct bsp_lock_stat_t
+{
+    const void          *lock;
+    const BSP_LOCK_SITE *site;
+    uint64_t            acquires;
+    uint64_t            contended;
+    uint64_t            spins;
+    uint64_t            wait_ns;
+} BSP_LOCK_STAT;
+
+typedef struct bsp_lock_name_t
+{
+    const void          *lock;
+    char                name[_BSP_LOCK_NAME_LENGTH];
+} BSP_LOCK_NAME;
+
+BSP_PRIVATE(BSP_LOCK_STAT) lock_stats[_BSP_LOCK_PROFILE_SLOTS];
+BSP_PRIVATE(BSP_LOCK_NAME) lock_names[_BSP_LOCK_PROFILE_NAMES];
+BSP_PRIVATE(__thread uint64_t) lock_spins = 0;
+
+    #define _COUNT_SPIN(n)              lock_spins += (n)
+#else
+    #define _COUNT_SPIN(n)
+#endif
+
 BSP_PRIVATE(inline uint8_t) _spin_cas(uint8_t compare, uint8_t val, uint8_t *lock)
 {
     uint8_t ret;
@@ -62,6 +96,7 @@ BSP_PRIVATE(inline void) _spin_sleep(BSP_TINY_SPINLOCK *lock)
         return;
     }
 
+    _COUNT_SPIN(1);
     if (0 == (lock->_loop_times & 0xF))
     {
         nanosleep(&ts, NULL);
@@ -122,6 +157,12 @@ BSP_DECLARE(void) bsp_tiny_spin_lock(BSP_TINY_SPINLOCK *lock)
     return;
 }
 
+// Try lock once
+BSP_DECLARE(BSP_BOOLEAN) bsp_tiny_spin_trylock(BSP_TINY_SPINLOCK *lock)
+{
+    return (lock && _spin_trylock(lock)) ? BSP_TRUE : BSP_FALSE;
+}
+
 // Try unlock
 BSP_DECLARE(void) bsp_tiny_spin_unlock(BSP_TINY_SPINLOCK *lock)
 {
@@ -143,3 +184,410 @@ BSP_DECLARE(void) bsp_tiny_spin_destroy(BSP_TINY_SPINLOCK *lock)
 
     return;
 }
+
+/* Ticket lock */
+// Initialize
+BSP_DECLARE(void) bsp_ticket_spin_init(BSP_TICKET_SPINLOCK *lock)
+{
+    if (lock)
+    {
+        lock->_next = 0;
+        lock->_owner = 0;
+    }
+
+    return;
+}
+
+// Take a ticket and wait for it
+BSP_DECLARE(void) bsp_ticket_spin_lock(BSP_TICKET_SPINLOCK *lock)
+{
+    if (!lock)
+    {
+        return;
+    }
+
+    if (0 == ncpus)
+    {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        ncpus = (n > 0) ? (uint32_t) n : 1;
+    }
+
+    uint32_t ticket = __atomic_fetch_add(&lock->_next, 1, __ATOMIC_RELAXED);
+    uint32_t owner, n, spins = 0;
+    while (ticket != (owner = __atomic_load_n(&lock->_owner, __ATOMIC_ACQUIRE)))
+    {
+        if (ticket - owner >= ncpus)
+        {
+            // More waiters ahead than CPUs, some of them are not running
+            sched_yield();
+
+            continue;
+        }
+
+        // Back off in proportion to waiters ahead, keep cache line quiet
+        n = (ticket - owner) * _TICKET_BACKOFF;
+        spins += n;
+        _COUNT_SPIN(n);
+        while (n --)
+        {
+            __asm__ __volatile__("pause");
+        }
+
+        if (spins >= _TICKET_YIELD_SPINS)
+        {
+            // Holder or next waiter may be preempted
+            sched_yield();
+            spins = 0;
+        }
+    }
+
+    return;
+}
+
+// Take a ticket only if it is served right now
+BSP_DECLARE(BSP_BOOLEAN) bsp_ticket_spin_trylock(BSP_TICKET_SPINLOCK *lock)
+{
+    if (!lock)
+    {
+        return BSP_FALSE;
+    }
+
+    uint32_t owner = __atomic_load_n(&lock->_owner, __ATOMIC_ACQUIRE);
+    uint32_t next = owner;
+
+    return __atomic_compare_exchange_n(&lock->_next, &next, owner + 1, BSP_FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) ? BSP_TRUE : BSP_FALSE;
+}
+
+// Serve next ticket
+BSP_DECLARE(void) bsp_ticket_spin_unlock(BSP_TICKET_SPINLOCK *lock)
+{
+    if (!lock)
+    {
+        return;
+    }
+
+    // Only holder writes owner
+    __atomic_store_n(&lock->_owner, lock->_owner + 1, __ATOMIC_RELEASE);
+
+    return;
+}
+
+// Destroy lock
+BSP_DECLARE(void) bsp_ticket_spin_destroy(BSP_TICKET_SPINLOCK *lock)
+{
+    // DO NOTHING
+
+    return;
+}
+
+/* Futex lock */
+BSP_PRIVATE(inline void) _futex_wait(uint32_t *addr, uint32_t val)
+{
+#ifdef OS_LINUX
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+#else
+    sched_yield();
+#endif
+    return;
+}
+
+BSP_PRIVATE(inline void) _futex_wake(uint32_t *addr)
+{
+#ifdef OS_LINUX
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#endif
+    return;
+}
+
+// Initialize
+BSP_DECLARE(void) bsp_futex_spin_init(BSP_FUTEX_SPINLOCK *lock)
+{
+    if (lock)
+    {
+        lock->_state = _FUTEX_FREE;
+    }
+
+    return;
+}
+
+// Spin, then park
+BSP_DECLARE(void) bsp_futex_spin_lock(BSP_FUTEX_SPINLOCK *lock)
+{
+    if (!lock)
+    {
+        return;
+    }
+
+    uint32_t c = _FUTEX_FREE;
+    int i;
+    if (__atomic_compare_exchange_n(&lock->_state, &c, _FUTEX_LOCKED, BSP_FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        // Fast path
+        return;
+    }
+
+    for (i = 0; i < _FUTEX_SPINS && _FUTEX_CONTENDED != c; i ++)
+    {
+        __asm__ __volatile__("pause");
+        _COUNT_SPIN(1);
+        c = __atomic_load_n(&lock->_state, __ATOMIC_RELAXED);
+        if (_FUTEX_FREE == c && 
+            __atomic_compare_exchange_n(&lock->_state, &c, _FUTEX_LOCKED, BSP_FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        {
+            return;
+        }
+    }
+
+    // Mark contended, so unlock knows to wake
+    c = __atomic_exchange_n(&lock->_state, _FUTEX_CONTENDED, __ATOMIC_ACQUIRE);
+    while (_FUTEX_FREE != c)
+    {
+        _futex_wait(&lock->_state, _FUTEX_CONTENDED);
+        c = __atomic_exchange_n(&lock->_state, _FUTEX_CONTENDED, __ATOMIC_ACQUIRE);
+    }
+
+    return;
+}
+
+// Try lock once
+BSP_DECLARE(BSP_BOOLEAN) bsp_futex_spin_trylock(BSP_FUTEX_SPINLOCK *lock)
+{
+    uint32_t c = _FUTEX_FREE;
+    if (!lock)
+    {
+        return BSP_FALSE;
+    }
+
+    return __atomic_compare_exchange_n(&lock->_state, &c, _FUTEX_LOCKED, BSP_FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) ? BSP_TRUE : BSP_FALSE;
+}
+
+// Unlock, wake one sleeper
+BSP_DECLARE(void) bsp_futex_spin_unlock(BSP_FUTEX_SPINLOCK *lock)
+{
+    if (!lock)
+    {
+        return;
+    }
+
+    if (_FUTEX_CONTENDED == __atomic_exchange_n(&lock->_state, _FUTEX_FREE, __ATOMIC_RELEASE))
+    {
+        _futex_wake(&lock->_state);
+    }
+
+    return;
+}
+
+// Destroy lock
+BSP_DECLARE(void) bsp_futex_spin_destroy(BSP_FUTEX_SPINLOCK *lock)
+{
+    // DO NOTHING
+
+    return;
+}
+
+/* Lock profiling */
+#ifdef ENABLE_LOCK_PROFILE
+BSP_PRIVATE(inline uint64_t) _now_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// Contended, start waiting
+BSP_DECLARE(void) bsp_lock_profile_wait(BSP_LOCK_WAIT *wait)
+{
+    if (wait)
+    {
+        wait->start_ns = _now_ns();
+        wait->spins = lock_spins;
+    }
+
+    return;
+}
+
+BSP_PRIVATE(inline size_t) _lock_hash(const void *a, const void *b)
+{
+    uint64_t h = ((uint64_t) (uintptr_t) a ^ ((uint64_t) (uintptr_t) b >> 4)) * 0x9E3779B97F4A7C15ULL;
+
+    return (size_t) (h >> 32);
+}
+
+// Slot of (site, lock), claim an empty one if not found
+BSP_PRIVATE(BSP_LOCK_STAT *) _lock_stat(const BSP_LOCK_SITE *site, const void *lock)
+{
+    size_t idx = _lock_hash(site, lock) % _BSP_LOCK_PROFILE_SLOTS;
+    size_t i;
+    const void *owner;
+    const BSP_LOCK_SITE *s;
+    BSP_LOCK_STAT *stat;
+    for (i = 0; i < _BSP_LOCK_PROFILE_SLOTS; i ++)
+    {
+        stat = &lock_stats[(idx + i) % _BSP_LOCK_PROFILE_SLOTS];
+        owner = __atomic_load_n(&stat->lock, __ATOMIC_ACQUIRE);
+        if (!owner)
+        {
+            if (__atomic_compare_exchange_n(&stat->lock, &owner, lock, BSP_FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            {
+                __atomic_store_n(&stat->site, site, __ATOMIC_RELEASE);
+
+                return stat;
+            }
+        }
+
+        if (owner != lock)
+        {
+            continue;
+        }
+
+        // Claimed by another thread, site comes right after
+        while (!(s = __atomic_load_n(&stat->site, __ATOMIC_ACQUIRE)))
+        {
+            __asm__ __volatile__("pause");
+        }
+
+        if (s == site)
+        {
+            return stat;
+        }
+    }
+
+    // Table full, pair not recorded
+    return NULL;
+}
+
+// Acquired
+BSP_DECLARE(void) bsp_lock_profile_acquired(const BSP_LOCK_SITE *site, const void *lock, BSP_LOCK_WAIT *wait)
+{
+    if (!site)
+    {
+        return;
+    }
+
+    BSP_LOCK_STAT *stat = _lock_stat(site, lock);
+    if (!stat)
+    {
+        return;
+    }
+
+    __atomic_add_fetch(&stat->acquires, 1, __ATOMIC_RELAXED);
+    if (wait)
+    {
+        __atomic_add_fetch(&stat->contended, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&stat->spins, lock_spins - wait->spins, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&stat->wait_ns, _now_ns() - wait->start_ns, __ATOMIC_RELAXED);
+    }
+
+    return;
+}
+
+// Name a lock
+BSP_DECLARE(void) bsp_lock_profile_name(const void *lock, const char *name)
+{
+    if (!lock)
+    {
+        return;
+    }
+
+    size_t idx = _lock_hash(lock, NULL) % _BSP_LOCK_PROFILE_NAMES;
+    size_t i;
+    const void *owner;
+    BSP_LOCK_NAME *n;
+    for (i = 0; i < _BSP_LOCK_PROFILE_NAMES; i ++)
+    {
+        n = &lock_names[(idx + i) % _BSP_LOCK_PROFILE_NAMES];
+        owner = __atomic_load_n(&n->lock, __ATOMIC_ACQUIRE);
+        if (owner == lock || 
+            (!owner && name && __atomic_compare_exchange_n(&n->lock, &owner, lock, BSP_FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)))
+        {
+            // Slot kept once claimed, a lock reusing the address renames it
+            snprintf(n->name, _BSP_LOCK_NAME_LENGTH, "%s", (name) ? name : "");
+
+            return;
+        }
+
+        if (!owner)
+        {
+            // Not named
+            return;
+        }
+    }
+
+    return;
+}
+
+BSP_PRIVATE(const char *) _lock_name(const void *lock)
+{
+    size_t idx = _lock_hash(lock, NULL) % _BSP_LOCK_PROFILE_NAMES;
+    size_t i;
+    const void *owner;
+    BSP_LOCK_NAME *n;
+    for (i = 0; i < _BSP_LOCK_PROFILE_NAMES; i ++)
+    {
+        n = &lock_names[(idx + i) % _BSP_LOCK_PROFILE_NAMES];
+        owner = __atomic_load_n(&n->lock, __ATOMIC_ACQUIRE);
+        if (!owner)
+        {
+            break;
+        }
+
+        if (owner == lock)
+        {
+            return (n->name[0]) ? n->name : NULL;
+        }
+    }
+
+    return NULL;
+}
+
+// Dump
+BSP_DECLARE(size_t) bsp_lock_profile_dump()
+{
+    size_t i, n = 0;
+    const BSP_LOCK_SITE *site;
+    const char *name;
+    BSP_LOCK_STAT *stat;
+    for (i = 0; i < _BSP_LOCK_PROFILE_SLOTS; i ++)
+    {
+        stat = &lock_stats[i];
+        site = __atomic_load_n(&stat->site, __ATOMIC_ACQUIRE);
+        if (!site)
+        {
+            continue;
+        }
+
+        name = _lock_name(stat->lock);
+        bsp_trace_message(BSP_TRACE_NOTICE, "Lock", "%s:%d (%s) lock %s [%p] : acquires %llu, contended %llu, spins %llu, wait %llu us", 
+                          site->file, 
+                          site->line, 
+                          site->func, 
+                          (name) ? name : "-", 
+                          stat->lock, 
+                          (unsigned long long) __atomic_load_n(&stat->acquires, __ATOMIC_RELAXED), 
+                          (unsigned long long) __atomic_load_n(&stat->contended, __ATOMIC_RELAXED), 
+                          (unsigned long long) __atomic_load_n(&stat->spins, __ATOMIC_RELAXED), 
+                          (unsigned long long) __atomic_load_n(&stat->wait_ns, __ATOMIC_RELAXED) / 1000);
+        n ++;
+    }
+
+    return n;
+}
+
+// Reset
+BSP_DECLARE(void) bsp_lock_profile_reset()
+{
+    size_t i;
+    BSP_LOCK_STAT *stat;
+    for (i = 0; i < _BSP_LOCK_PROFILE_SLOTS; i ++)
+    {
+        stat = &lock_stats[i];
+        __atomic_store_n(&stat->acquires, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stat->contended, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stat->spins, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stat->wait_ns, 0, __ATOMIC_RELAXED);
+    }
+
+    return;
+}
+#endif
@@ -46,6 +46,15 @@
 /* Definations */
 #define _SPIN_FREE                      0
 #define _SPIN_LOCKED                    1
+// Pause loops per waiter ahead in ticket queue
+#define _TICKET_BACKOFF                 32
+// Pause loops before yielding CPU
+#define _TICKET_YIELD_SPINS             2048
+// Futex lock states and spins before parking
+#define _FUTEX_FREE                     0
+#define _FUTEX_LOCKED                   1
+#define _FUTEX_CONTENDED                2
+#define _FUTEX_SPINS                    128
 
 /* Macros */
 
@@ -56,6 +65,33 @@ typedef struct bsp_tiny_spinlock_t
     uint8_t             _loop_times;
 } BSP_TINY_SPINLOCK;
 
+// FIFO ticket lock
+typedef struct bsp_ticket_spinlock_t
+{
+    uint32_t            _next;
+    uint32_t            _owner;
+} BSP_TICKET_SPINLOCK;
+
+// Spin briefly, then park on futex
+typedef struct bsp_futex_spinlock_t
+{
+    uint32_t            _state;
+} BSP_FUTEX_SPINLOCK;
+
+// Lock profiling, one per bsp_spin_lock() call site, counters kept per (site, lock)
+typedef struct bsp_lock_site_t
+{
+    const char          *file;
+    const char          *func;
+    int                 line;
+} BSP_LOCK_SITE;
+
+typedef struct bsp_lock_wait_t
+{
+    uint64_t            start_ns;
+    uint64_t            spins;
+} BSP_LOCK_WAIT;
+
 /* Functions */
 /**
  * Tiny spinlock initialization
@@ -75,6 +111,15 @@ BSP_DECLARE(void) bsp_tiny_spin_init(BSP_TINY_SPINLOCK *lock);
  */
 BSP_DECLARE(void) bsp_tiny_spin_lock(BSP_TINY_SPINLOCK *lock);
 
+/**
+ * Try lock without waiting
+ *
+ * @param BSP_TINY_SPINLOCK lock Lock
+ *
+ * @return BSP_BOOLEAN Locked
+ */
+BSP_DECLARE(BSP_BOOLEAN) bsp_tiny_spin_trylock(BSP_TINY_SPINLOCK *lock);
+
 /**
  * Unlock a locked spin
  *
@@ -94,4 +139,123 @@ BSP_DECLARE(void) bsp_tiny_spin_unlock(BSP_TINY_SPINLOCK *lock);
  */
 BSP_DECLARE(void) bsp_tiny_spin_destroy(BSP_TINY_SPINLOCK *lock);
 
+/**
+ * Initialize a ticket spinlock
+ *
+ * @param BSP_TICKET_SPINLOCK lock Lock
+ */
+BSP_DECLARE(void) bsp_ticket_spin_init(BSP_TICKET_SPINLOCK *lock);
+
+/**
+ * Lock. Waiters acquire in arrival order
+ *
+ * @param BSP_TICKET_SPINLOCK lock Lock
+ */
+BSP_DECLARE(void) bsp_ticket_spin_lock(BSP_TICKET_SPINLOCK *lock);
+
+/**
+ * Try lock, only succeeds if nobody holds or waits
+ *
+ * @param BSP_TICKET_SPINLOCK lock Lock
+ *
+ * @return BSP_BOOLEAN Locked
+ */
+BSP_DECLARE(BSP_BOOLEAN) bsp_ticket_spin_trylock(BSP_TICKET_SPINLOCK *lock);
+
+/**
+ * Unlock, hand over to next ticket
+ *
+ * @param BSP_TICKET_SPINLOCK lock Lock
+ */
+BSP_DECLARE(void) bsp_ticket_spin_unlock(BSP_TICKET_SPINLOCK *lock);
+
+/**
+ * Destroy a ticket spinlock
+ *
+ * @param BSP_TICKET_SPINLOCK lock Lock
+ */
+BSP_DECLARE(void) bsp_ticket_spin_destroy(BSP_TICKET_SPINLOCK *lock);
+
+/**
+ * Initialize a futex spinlock
+ *
+ * @param BSP_FUTEX_SPINLOCK lock Lock
+ */
+BSP_DECLARE(void) bsp_futex_spin_init(BSP_FUTEX_SPINLOCK *lock);
+
+/**
+ * Lock. Spin for a short while, then sleep until woken by unlock
+ *
+ * @param BSP_FUTEX_SPINLOCK lock Lock
+ */
+BSP_DECLARE(void) bsp_futex_spin_lock(BSP_FUTEX_SPINLOCK *lock);
+
+/**
+ * Try lock without waiting
+ *
+ * @param BSP_FUTEX_SPINLOCK lock Lock
+ *
+ * @return BSP_BOOLEAN Locked
+ */
+BSP_DECLARE(BSP_BOOLEAN) bsp_futex_spin_trylock(BSP_FUTEX_SPINLOCK *lock);
+
+/**
+ * Unlock, wake one sleeper if any
+ *
+ * @param BSP_FUTEX_SPINLOCK lock Lock
+ */
+BSP_DECLARE(void) bsp_futex_spin_unlock(BSP_FUTEX_SPINLOCK *lock);
+
+/**
+ * Destroy a futex spinlock
+ *
+ * @param BSP_FUTEX_SPINLOCK lock Lock
+ */
+BSP_DECLARE(void) bsp_futex_spin_destroy(BSP_FUTEX_SPINLOCK *lock);
+
+#if BSP_LOCK_PROFILE
+/**
+ * Start waiting on a contended lock (used by profiling bsp_spin_lock())
+ *
+ * @param BSP_LOCK_WAIT wait Wait record
+ */
+BSP_DECLARE(void) bsp_lock_profile_wait(BSP_LOCK_WAIT *wait);
+
+/**
+ * Lock acquired at site (used by profiling bsp_spin_lock())
+ *
+ * @param BSP_LOCK_SITE site Call site
+ * @param pointer lock Lock instance
+ * @param BSP_LOCK_WAIT wait Wait record, NULL if not contended
+ */
+BSP_DECLARE(void) bsp_lock_profile_acquired(const BSP_LOCK_SITE *site, const void *lock, BSP_LOCK_WAIT *wait);
+
+/**
+ * Name a lock instance in profile (used by bsp_spin_set_name()). Name is copied,
+ * NULL drops it
+ *
+ * @param pointer lock Lock instance
+ * @param string name Name
+ */
+BSP_DECLARE(void) bsp_lock_profile_name(const void *lock, const char *name);
+
+/**
+ * Write counters of all (site, lock) pairs to trace
+ *
+ * @return size_t Number of pairs
+ */
+BSP_DECLARE(size_t) bsp_lock_profile_dump();
+
+/**
+ * Clear counters of all (site, lock) pairs
+ */
+BSP_DECLARE(void) bsp_lock_profile_reset();
+#else
+    #define bsp_lock_profile_wait(wait)
+    #define bsp_lock_profile_acquired(site, lock, wait)
+    #define bsp_lock_profile_name(lock, name)
+    #define bsp_lock_profile_dump()     ((size_t) 0)
+    #define bsp_lock_profile_reset()
+#endif
+
 #endif  /* _CORE_BSP_TINYSPIN_H */
@@ -36,6 +36,10 @@
  * @update 02/18/2015
  * @changelog
  *      [02/18/2015] - Creation
+ *      [10/18/2026] - Compacting mode with size limit
+ *      [10/18/2026] - Thread cache of buffer memory
+ *      [10/18/2026] - Adaptive read size
+ *      [10/18/2026] - Refcounted slices
  */
 
 #include "bsp-private.h"
@@ -44,13 +48,178 @@
 BSP_PRIVATE(BSP_MEMPOOL *) mp_buffer = NULL;
 BSP_PRIVATE(const char *) _tag_ = "Buffer";
 
+// Per-thread cache of buffer memory, blocks of power-of-2 size classes
+typedef struct bsp_buffer_cache_t
+{
+    char                *blocks[_BSP_BUFFER_CACHE_CLASSES][_BSP_BUFFER_CACHE_DEPTH];
+    size_t              nblocks[_BSP_BUFFER_CACHE_CLASSES];
+    size_t              bytes;
+} BSP_BUFFER_CACHE;
+
+BSP_PRIVATE(pthread_key_t) cache_key;
+BSP_PRIVATE(pthread_once_t) cache_key_once = PTHREAD_ONCE_INIT;
+
+// Thread exit, free cached blocks
+BSP_PRIVATE(void) _cache_destroy(void *arg)
+{
+    BSP_BUFFER_CACHE *c = (BSP_BUFFER_CACHE *) arg;
+    int i;
+    size_t j;
+    if (c)
+    {
+        for (i = 0; i < _BSP_BUFFER_CACHE_CLASSES; i ++)
+        {
+            for (j = 0; j < c->nblocks[i]; j ++)
+            {
+                bsp_free(c->blocks[i][j]);
+            }
+        }
+
+        bsp_free(c);
+    }
+
+    return;
+}
+
+BSP_PRIVATE(void) _cache_key_create()
+{
+    pthread_key_create(&cache_key, _cache_destroy);
+
+    return;
+}
+
+BSP_PRIVATE(BSP_BUFFER_CACHE *) _get_cache()
+{
+    pthread_once(&cache_key_once, _cache_key_create);
+    BSP_BUFFER_CACHE *c = (BSP_BUFFER_CACHE *) pthread_getspecific(cache_key);
+    if (!c)
+    {
+        c = bsp_calloc(1, sizeof(BSP_BUFFER_CACHE));
+        if (c)
+        {
+            pthread_setspecific(cache_key, c);
+        }
+    }
+
+    return c;
+}
+
+// Size class of block, -1 if not cacheable
+BSP_PRIVATE(int) _cache_class(size_t size)
+{
+    int idx;
+    if (0 == size || (size & (size - 1)))
+    {
+        return -1;
+    }
+
+    idx = bsp_log2((int) (size >> _BSP_BUFFER_CACHE_MIN_SHIFT));
+    if (size < ((size_t) 1 << _BSP_BUFFER_CACHE_MIN_SHIFT) || idx >= _BSP_BUFFER_CACHE_CLASSES)
+    {
+        return -1;
+    }
+
+    return idx;
+}
+
+BSP_PRIVATE(char *) _cache_take(size_t size)
+{
+    int idx = _cache_class(size);
+    BSP_BUFFER_CACHE *c;
+    if (idx < 0 || !(c = _get_cache()) || 0 == c->nblocks[idx])
+    {
+        return NULL;
+    }
+
+    c->bytes -= size;
+
+    return c->blocks[idx][-- c->nblocks[idx]];
+}
+
+BSP_PRIVATE(void) _cache_give(char *data, size_t size)
+{
+    int idx = _cache_class(size);
+    BSP_BUFFER_CACHE *c;
+    if (idx >= 0 && 
+        (c = _get_cache()) && 
+        c->nblocks[idx] < _BSP_BUFFER_CACHE_DEPTH && 
+        c->bytes + size <= _BSP_BUFFER_CACHE_BYTES)
+    {
+        c->blocks[idx][c->nblocks[idx] ++] = data;
+        c->bytes += size;
+
+        return;
+    }
+
+    bsp_free(data);
+
+    return;
+}
+
+// Drop the block shared with slices, buffer becomes empty
+BSP_PRIVATE(void) _drop_shared(BSP_BUFFER *b)
+{
+    if (b->shared)
+    {
+        bsp_unref_slice(b->shared);
+        b->shared = NULL;
+        B_DATA(b) = NULL;
+        B_SIZE(b) = 0;
+        B_LEN(b) = 0;
+        B_NOW(b) = 0;
+    }
+
+    return;
+}
+
+// Move unprocessed data out of shared block before writing
+BSP_PRIVATE(int) _unshare_buffer(BSP_BUFFER *b)
+{
+    if (!b->shared)
+    {
+        return BSP_RTN_SUCCESS;
+    }
+
+    size_t avail = B_AVAIL(b), size = B_SIZE(b);
+    char *data = NULL;
+    if (avail > 0)
+    {
+        data = _cache_take(size);
+        if (!data)
+        {
+            data = bsp_malloc(size);
+            if (!data)
+            {
+                bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Unshare buffer failed");
+
+                return BSP_RTN_ERR_MEMORY;
+            }
+        }
+
+        memcpy(data, B_CURR(b), avail);
+    }
+
+    bsp_unref_slice(b->shared);
+    b->shared = NULL;
+    B_DATA(b) = data;
+    B_SIZE(b) = data ? size : 0;
+    B_LEN(b) = avail;
+    B_NOW(b) = 0;
+
+    return BSP_RTN_SUCCESS;
+}
+
 /* Mempool freer */
 BSP_PRIVATE(void) _buffer_free(void *item)
 {
     BSP_BUFFER *b = (BSP_BUFFER *) item;
     if (b)
     {
-        if (B_DATA(b) && !B_ISCONST(b))
+        if (b->shared)
+        {
+            _drop_shared(b);
+        }
+        else if (B_DATA(b) && !B_ISCONST(b))
         {
             bsp_free(B_DATA(b));
         }
@@ -85,7 +254,26 @@ BSP_PRIVATE(int) _enlarge_buffer(BSP_BUFFER *b, size_t size)
     if (b && size > B_SIZE(b))
     {
         size_t new_size = 2 << bsp_log2(size);
-        char *new_data = bsp_realloc(B_DATA(b), new_size);
+        if (B_LIMIT(b) > 0 && new_size > B_LIMIT(b))
+        {
+            new_size = B_LIMIT(b);
+        }
+
+        char *new_data = _cache_take(new_size);
+        if (new_data)
+        {
+            // Move to cached block instead of realloc
+            if (B_DATA(b))
+            {
+                memcpy(new_data, B_DATA(b), B_LEN(b));
+                _cache_give(B_DATA(b), B_SIZE(b));
+            }
+        }
+        else
+        {
+            new_data = bsp_realloc(B_DATA(b), new_size);
+        }
+
         if (new_data)
         {
             B_DATA(b) = new_data;
@@ -132,6 +320,42 @@ BSP_PRIVATE(int) _shrink_buffer(BSP_BUFFER *b)
     return BSP_RTN_ERR_GENERAL;
 }
 
+// Make room for len bytes at the tail, returns room actually available
+BSP_PRIVATE(size_t) _reserve_buffer(BSP_BUFFER *b, size_t len)
+{
+    if (BSP_RTN_SUCCESS != _unshare_buffer(b))
+    {
+        return 0;
+    }
+
+    size_t need = B_LEN(b) + len;
+    if (need > B_SIZE(b) && B_NOW(b) > 0)
+    {
+        // Reclaim consumed head instead of growing
+        bsp_buffer_compact(b);
+        need = B_LEN(b) + len;
+    }
+
+    if (B_LIMIT(b) > 0 && need > B_LIMIT(b))
+    {
+        need = B_LIMIT(b);
+    }
+
+    if (need > B_SIZE(b) && BSP_RTN_SUCCESS != _enlarge_buffer(b, need))
+    {
+        // Enlarge error
+        return 0;
+    }
+
+    if (need <= B_LEN(b))
+    {
+        // Limit reached
+        return 0;
+    }
+
+    return need - B_LEN(b);
+}
+
 // New buffer
 BSP_DECLARE(BSP_BUFFER *) bsp_new_buffer()
 {
@@ -140,6 +364,10 @@ BSP_DECLARE(BSP_BUFFER *) bsp_new_buffer()
     {
         B_LEN(b) = 0;
         B_NOW(b) = 0;
+        B_LIMIT(b) = 0;
+        b->shared = NULL;
+        b->read_hint = 0;
+        b->read_shrink = BSP_FALSE;
         b->is_const = BSP_FALSE;
     }
 
@@ -151,6 +379,7 @@ BSP_DECLARE(void) bsp_del_buffer(BSP_BUFFER *b)
 {
     if (b)
     {
+        _drop_shared(b);
         if (!B_ISCONST(b))
         {
             if (_BSP_BUFFER_HIGHWATER < B_SIZE(b))
@@ -198,6 +427,192 @@ BSP_DECLARE(void) bsp_clear_buffer(BSP_BUFFER *b)
     return;
 }
 
+// Give buffer memory back
+BSP_DECLARE(void) bsp_buffer_release(BSP_BUFFER *b)
+{
+    if (b)
+    {
+        if (b->shared)
+        {
+            _drop_shared(b);
+        }
+        else if (B_DATA(b) && !B_ISCONST(b))
+        {
+            _cache_give(B_DATA(b), B_SIZE(b));
+        }
+
+        B_DATA(b) = NULL;
+        B_SIZE(b) = 0;
+        B_LEN(b) = 0;
+        B_NOW(b) = 0;
+        b->is_const = BSP_FALSE;
+    }
+
+    return;
+}
+
+// Limit buffer size
+BSP_DECLARE(void) bsp_buffer_set_limit(BSP_BUFFER *b, size_t limit)
+{
+    if (b)
+    {
+        B_LIMIT(b) = limit;
+    }
+
+    return;
+}
+
+// Move unprocessed data to the head of buffer
+BSP_DECLARE(size_t) bsp_buffer_compact(BSP_BUFFER *b)
+{
+    if (!b || B_ISCONST(b) || 0 == B_NOW(b))
+    {
+        return 0;
+    }
+
+    size_t reclaimed = B_NOW(b);
+    if (b->shared)
+    {
+        // Unsharing moves data to the head of a new block
+        return (BSP_RTN_SUCCESS == _unshare_buffer(b)) ? reclaimed : 0;
+    }
+
+    if (B_AVAIL(b) > 0)
+    {
+        memmove(B_DATA(b), B_CURR(b), B_AVAIL(b));
+    }
+
+    B_LEN(b) -= reclaimed;
+    B_NOW(b) = 0;
+
+    return reclaimed;
+}
+
+/* Slices */
+BSP_PRIVATE(BSP_SLICE *) _new_sub_slice(BSP_SLICE *root, const char *data, size_t len)
+{
+    BSP_SLICE *slice = bsp_malloc(sizeof(BSP_SLICE));
+    if (!slice)
+    {
+        bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Create slice failed");
+
+        return NULL;
+    }
+
+    slice->data = data;
+    slice->len = len;
+    slice->refcount = 1;
+    slice->root = bsp_ref_slice(root);
+    slice->block = NULL;
+    slice->block_size = 0;
+
+    return slice;
+}
+
+// Take a slice from buffer
+BSP_DECLARE(BSP_SLICE *) bsp_buffer_slice(BSP_BUFFER *b, size_t offset, size_t len)
+{
+    if (!b || B_ISCONST(b) || !B_DATA(b) || offset + len > B_AVAIL(b))
+    {
+        return NULL;
+    }
+
+    if (!b->shared)
+    {
+        // Block handed over to a root slice, referenced by buffer
+        BSP_SLICE *root = bsp_malloc(sizeof(BSP_SLICE));
+        if (!root)
+        {
+            bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Create slice failed");
+
+            return NULL;
+        }
+
+        root->data = B_DATA(b);
+        root->len = B_LEN(b);
+        root->refcount = 1;
+        root->root = NULL;
+        root->block = B_DATA(b);
+        root->block_size = B_SIZE(b);
+        b->shared = root;
+    }
+
+    return _new_sub_slice(b->shared, B_CURR(b) + offset, len);
+}
+
+// Standalone slice, header and data in one allocation
+BSP_DECLARE(BSP_SLICE *) bsp_new_slice(const char *data, ssize_t len)
+{
+    if (!data)
+    {
+        return NULL;
+    }
+
+    if (len < 0)
+    {
+        len = strnlen(data, _BSP_MAX_UNSIZED_STRLEN);
+    }
+
+    BSP_SLICE *slice = bsp_malloc(sizeof(BSP_SLICE) + len);
+    if (!slice)
+    {
+        bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Create slice failed");
+
+        return NULL;
+    }
+
+    memcpy((char *) (slice + 1), data, len);
+    slice->data = (const char *) (slice + 1);
+    slice->len = len;
+    slice->refcount = 1;
+    slice->root = NULL;
+    slice->block = NULL;
+    slice->block_size = 0;
+
+    return slice;
+}
+
+// Region of slice
+BSP_DECLARE(BSP_SLICE *) bsp_sub_slice(BSP_SLICE *slice, size_t offset, size_t len)
+{
+    if (!slice || offset + len > slice->len)
+    {
+        return NULL;
+    }
+
+    return _new_sub_slice(slice->root ? slice->root : slice, slice->data + offset, len);
+}
+
+BSP_DECLARE(BSP_SLICE *) bsp_ref_slice(BSP_SLICE *slice)
+{
+    if (slice)
+    {
+        __atomic_add_fetch(&slice->refcount, 1, __ATOMIC_RELAXED);
+    }
+
+    return slice;
+}
+
+BSP_DECLARE(void) bsp_unref_slice(BSP_SLICE *slice)
+{
+    if (slice && 0 == __atomic_sub_fetch(&slice->refcount, 1, __ATOMIC_ACQ_REL))
+    {
+        if (slice->root)
+        {
+            bsp_unref_slice(slice->root);
+        }
+        else if (slice->block)
+        {
+            // Block goes to cache of thread dropping the last reference
+            _cache_give(slice->block, slice->block_size);
+        }
+
+        bsp_free(slice);
+    }
+
+    return;
+}
+
 // Set const data to en empty buffer
 BSP_DECLARE(size_t) bsp_buffer_set_const(BSP_BUFFER *b, const char *data, ssize_t len)
 {
@@ -211,7 +626,11 @@ BSP_DECLARE(size_t) bsp_buffer_set_const(BSP_BUFFER *b, const char *data, ssize_
         len = strnlen(data, _BSP_MAX_UNSIZED_STRLEN);
     }
 
-    if (B_DATA(b))
+    if (b->shared)
+    {
+        _drop_shared(b);
+    }
+    else if (B_DATA(b))
     {
         bsp_free(B_DATA(b));
     }
@@ -238,19 +657,14 @@ BSP_DECLARE(size_t) bsp_buffer_append(BSP_BUFFER *b, const char *data, ssize_t l
         len = strnlen(data, _BSP_MAX_UNSIZED_STRLEN);
     }
 
-    size_t need = B_LEN(b) + len;
-    if (need > B_SIZE(b))
+    if (_reserve_buffer(b, len) < (size_t) len)
     {
-        // Space not enough, realloc buffer
-        if (BSP_RTN_SUCCESS != _enlarge_buffer(b, need))
-        {
-            // Enlarge error
-            return 0;
-        }
+        // Space not enough and cannot be enlarged
+        return 0;
     }
 
     memcpy(B_DATA(b) + B_LEN(b), data, len);
-    B_LEN(b) = need;
+    B_LEN(b) += len;
 
     return len;
 }
@@ -288,18 +702,13 @@ BSP_DECLARE(size_t) bsp_buffer_fill(BSP_BUFFER *b, int code, size_t len)
         return 0;
     }
 
-    size_t need = B_LEN(b) + len;
-    if (need > B_SIZE(b))
+    if (B_ISCONST(b) || _reserve_buffer(b, len) < len)
     {
-        if (BSP_RTN_SUCCESS != _enlarge_buffer(b, need))
-        {
-            // Enlarge error
-            return 0;
-        }
+        return 0;
     }
 
     memset(B_DATA(b) + B_LEN(b), code, len);
-    B_LEN(b) = need;
+    B_LEN(b) += len;
 
     return len;
 }
@@ -312,14 +721,16 @@ BSP_DECLARE(ssize_t) bsp_buffer_io_read(BSP_BUFFER *b, int fd, size_t len)
         return 0;
     }
 
-    size_t need = B_LEN(b) + len;
-    if (need > B_SIZE(b))
+    size_t room = _reserve_buffer(b, len);
+    if (0 == room)
     {
-        if (BSP_RTN_SUCCESS != _enlarge_buffer(b, need))
-        {
-            // Enlarge error
-            return 0;
-        }
+        // Buffer full
+        return 0;
+    }
+
+    if (len > room)
+    {
+        len = room;
     }
 
     // Try read
@@ -341,27 +752,65 @@ BSP_DECLARE(ssize_t) bsp_buffer_io_read_all(BSP_BUFFER *b, int fd)
         return 0;
     }
 
+    char spill[_BSP_FD_READ_MAX];
+    struct iovec iov[2];
     ssize_t len = 0, tlen = 0;
+    size_t want, room, hint = b->read_hint ? b->read_hint : _BSP_FD_READ_ONCE;
     while (BSP_TRUE)
     {
-        size_t need = B_LEN(b) + _BSP_FD_READ_ONCE;
-        if (need > B_SIZE(b))
+        want = hint;
+        if (0 == _reserve_buffer(b, (want < _BSP_FD_READ_ONCE) ? want : _BSP_FD_READ_ONCE))
+        {
+            // Buffer full (or enlarge error), leave the rest in kernel
+            break;
+        }
+
+        room = B_SIZE(b) - B_LEN(b);
+        if (B_LIMIT(b) > 0)
         {
-            if (BSP_RTN_SUCCESS != _enlarge_buffer(b, need))
+            if (room > B_LIMIT(b) - B_LEN(b))
             {
-                // Enlarge error
-                break;
+                room = B_LIMIT(b) - B_LEN(b);
+            }
+
+            if (want > B_LIMIT(b) - B_LEN(b))
+            {
+                want = B_LIMIT(b) - B_LEN(b);
             }
         }
 
-        len = read(fd, B_DATA(b) + B_LEN(b), _BSP_FD_READ_ONCE);
+        if (room >= want)
+        {
+            len = read(fd, B_DATA(b) + B_LEN(b), want);
+        }
+        else
+        {
+            // Tail of buffer first, overflow to stack
+            iov[0].iov_base = B_DATA(b) + B_LEN(b);
+            iov[0].iov_len = room;
+            iov[1].iov_base = spill;
+            iov[1].iov_len = want - room;
+            len = readv(fd, iov, 2);
+        }
+
         if (len < 0)
         {
-            if (EINTR == errno || EWOULDBLOCK == errno || EAGAIN == errno)
+            if (EINTR == errno)
+            {
+                // Interrupted before any data, edge would be lost if we stop here
+                continue;
+            }
+
+            if (EWOULDBLOCK == errno || EAGAIN == errno)
             {
                  // Break
                 break;
             }
+
+            // Connection reset or fd broken, nothing more will come
+            bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Read fd %d failed : %s", fd, strerror(errno));
+            tlen = -1;
+            break;
         }
         else if (0 == len)
         {
@@ -373,15 +822,47 @@ BSP_DECLARE(ssize_t) bsp_buffer_io_read_all(BSP_BUFFER *b, int fd)
         {
             // Data already in buffer -_-
             tlen += len;
-            B_LEN(b) += len;
+            if ((size_t) len > room)
+            {
+                B_LEN(b) += room;
+                if (bsp_buffer_append(b, spill, len - room) < (size_t) len - room)
+                {
+                    bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Lost %d bytes from fd %d", (int) (len - room), fd);
+                }
+            }
+            else
+            {
+                B_LEN(b) += len;
+            }
+
             bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Read %d bytes from fd %d to buffer", (int) len, fd);
-            if (len < _BSP_FD_READ_ONCE)
+            if ((size_t) len < want)
             {
                 // All gone
                 break;
             }
+
+            // Read filled, more may be waiting
+            hint = (hint << 2 > _BSP_FD_READ_MAX) ? _BSP_FD_READ_MAX : hint << 2;
+            b->read_shrink = BSP_FALSE;
+        }
+    }
+
+    if (tlen > 0 && (size_t) tlen < (hint >> 1))
+    {
+        // Shrink only if twice in a row
+        if (b->read_shrink)
+        {
+            hint = (hint >> 1 < _BSP_FD_READ_MIN) ? _BSP_FD_READ_MIN : hint >> 1;
+            b->read_shrink = BSP_FALSE;
+        }
+        else
+        {
+            b->read_shrink = BSP_TRUE;
         }
     }
 
+    b->read_hint = hint;
+
     return tlen;
 }
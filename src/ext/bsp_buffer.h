@@ -36,6 +36,10 @@
  * @update 02/18/2015
  * @changelog
  *      [02/18/2015] - Creation
+ *      [10/18/2026] - Compacting mode with size limit
+ *      [10/18/2026] - Thread cache of buffer memory
+ *      [10/18/2026] - Adaptive read size
+ *      [10/18/2026] - Refcounted slices
  */
 
 #ifndef _EXT_BSP_BUFFER_H
@@ -44,12 +48,28 @@
 /* Headers */
 
 /* Definations */
+// Immutable, refcounted view of bytes. Root slice owns the memory block,
+// sub slices hold a reference of root
+typedef struct bsp_slice_t
+{
+    const char          *data;
+    size_t              len;
+    int                 refcount;
+    struct bsp_slice_t  *root;
+    char                *block;
+    size_t              block_size;
+} BSP_SLICE;
+
 typedef struct bsp_buffer_t
 {
     char                *data;
     size_t              size;           // Buffer length
     size_t              data_len;       // Data length
     size_t              cursor;
+    size_t              limit;          // Maximum buffer size, 0 for unlimited
+    size_t              read_hint;      // Adaptive read size, 0 for default
+    BSP_BOOLEAN         read_shrink;
+    BSP_SLICE           *shared;        // Root slice of data block, block is read-only while shared
     BSP_BOOLEAN         is_const;
 } BSP_BUFFER;
 
@@ -65,6 +85,8 @@ typedef struct bsp_buffer_t
 #define B_AVAIL(b)                      (b->data_len - b->cursor)
 #define B_CURR(b)                       (b->data + b->cursor)
 #define B_ISCONST(b)                    (BSP_TRUE == b->is_const)
+#define B_LIMIT(b)                      b->limit
+#define B_FULL(b)                       (b->limit > 0 && b->data_len >= b->limit)
 
 #define B_PASS(b, n)                    b->cursor += n; \
                                         if (b->cursor >= b->data_len) {b->cursor = 0; b->data_len = 0;}
@@ -102,6 +124,83 @@ BSP_DECLARE(void) bsp_del_buffer(BSP_BUFFER *b);
  */
 BSP_DECLARE(void) bsp_clear_buffer(BSP_BUFFER *b);
 
+/**
+ * Take a slice from unprocessed data of buffer without copying. The data
+ * block is shared with slice from now on, buffer moves its remaining data
+ * to a new block before next writing
+ *
+ * @param BSP_BUFFER b Buffer
+ * @param size_t offset Offset from cursor (B_CURR)
+ * @param size_t len Length of slice
+ *
+ * @return p BSP_SLICE
+ */
+BSP_DECLARE(BSP_SLICE *) bsp_buffer_slice(BSP_BUFFER *b, size_t offset, size_t len);
+
+/**
+ * Generate a standalone slice, data copied
+ *
+ * @param string data Data
+ * @param ssize_t len Length of data
+ *
+ * @return p BSP_SLICE
+ */
+BSP_DECLARE(BSP_SLICE *) bsp_new_slice(const char *data, ssize_t len);
+
+/**
+ * Take a region of slice without copying
+ *
+ * @param BSP_SLICE slice Parent slice
+ * @param size_t offset Offset in parent
+ * @param size_t len Length of region
+ *
+ * @return p BSP_SLICE
+ */
+BSP_DECLARE(BSP_SLICE *) bsp_sub_slice(BSP_SLICE *slice, size_t offset, size_t len);
+
+/**
+ * Add a reference to slice, thread safe
+ *
+ * @param BSP_SLICE slice Slice
+ *
+ * @return p BSP_SLICE
+ */
+BSP_DECLARE(BSP_SLICE *) bsp_ref_slice(BSP_SLICE *slice);
+
+/**
+ * Drop a reference of slice, thread safe. Slice freed with the last reference
+ *
+ * @param BSP_SLICE slice Slice
+ */
+BSP_DECLARE(void) bsp_unref_slice(BSP_SLICE *slice);
+
+/**
+ * Give buffer memory back to thread cache (or free it), buffer becomes empty.
+ * Next growing of buffer takes memory from cache of the running thread
+ *
+ * @param BSP_BUFFER b Buffer to release
+ */
+BSP_DECLARE(void) bsp_buffer_release(BSP_BUFFER *b);
+
+/**
+ * Limit the size of buffer. A limited buffer never grows beyond limit, the
+ * consumed head will be compacted out before growing instead, so unprocessed
+ * data always stays contiguous from B_CURR()
+ *
+ * @param BSP_BUFFER b Buffer to limit
+ * @param size_t limit Maximum size in bytes, 0 for unlimited
+ */
+BSP_DECLARE(void) bsp_buffer_set_limit(BSP_BUFFER *b, size_t limit);
+
+/**
+ * Move unprocessed data (from cursor) to the head of buffer
+ *
+ * @param BSP_BUFFER b Buffer to compact
+ *
+ * @return size_t Bytes reclaimed
+ */
+BSP_DECLARE(size_t) bsp_buffer_compact(BSP_BUFFER *b);
+
 /**
  * Set an empty buffer const data, after set, buffer will be set to const mode
  *
@@ -158,6 +257,11 @@ BSP_DECLARE(ssize_t) bsp_buffer_io_read(BSP_BUFFER *b, int fd, size_t len);
 
 /**
  * Read all data from file descriptor into buffer
+ * Reading stops when a limited buffer is full (B_FULL), the remaining data
+ * stays in kernel until the buffer is consumed.
+ * Read size adapts to recent reads of this buffer: grows when a read fills
+ * it, shrinks when two calls in a row read less than half. Buffer only
+ * reserves a small tail, the rest goes through readv() into a stack spill
  *
  * @param BSP_BUFFER b Buffer to append
  * @param int fd File descriptor
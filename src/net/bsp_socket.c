@@ -41,17 +41,98 @@
 #include "bsp-private.h"
 #include "bsp.h"
 
+#ifdef OS_LINUX
+#include <sys/sendfile.h>
+#include <poll.h>
+#include <linux/errqueue.h>
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+#define _SOCKET_ZEROCOPY                1
+#endif
+#if defined(SOL_UDP) && defined(UDP_SEGMENT) && defined(UDP_GRO)
+#define _SOCKET_UDP_OFFLOAD             1
+#endif
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+#include <linux/filter.h>
+#define _SOCKET_REUSEPORT_CBPF          1
+#endif
+#endif
+
+#ifndef OS_LINUX
+// Same layout as Linux mmsghdr, sent / received one by one
+struct mmsghdr
+{
+    struct msghdr       msg_hdr;
+    unsigned int        msg_len;
+};
+#endif
+
+// Control message of UDP_GRO / UDP_SEGMENT
+typedef union bsp_udp_cmsg_t
+{
+    char                buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr      align;
+} BSP_UDP_CMSG;
+
+// Per-thread datagram ring, inbound batch and outbound queue
+typedef struct bsp_udp_ring_t
+{
+    struct mmsghdr      in_msgs[_BSP_UDP_BATCH];
+    struct iovec        in_iovs[_BSP_UDP_BATCH];
+    struct sockaddr_storage
+                        in_addrs[_BSP_UDP_BATCH];
+    BSP_UDP_CMSG        in_ctls[_BSP_UDP_BATCH];
+    struct mmsghdr      out_msgs[_BSP_UDP_BATCH];
+    struct iovec        out_iovs[_BSP_UDP_BATCH];
+    struct sockaddr_storage
+                        out_addrs[_BSP_UDP_BATCH];
+    BSP_SOCKET          *out_scks[_BSP_UDP_BATCH];
+    size_t              nout;
+
+    // Messages on wire, each covers one or more queued datagrams
+    struct mmsghdr      wire_msgs[_BSP_UDP_BATCH];
+    BSP_UDP_CMSG        wire_ctls[_BSP_UDP_BATCH];
+    size_t              wire_count[_BSP_UDP_BATCH];
+    char                *in_slots;
+    char                *out_slots;
+} BSP_UDP_RING;
+
+#ifdef _SOCKET_ZEROCOPY
+// Closed socket whose zero copy sends are not completed yet
+typedef struct bsp_socket_orphan_t
+{
+    int                 fd;
+    uint32_t            zc_done;
+    BSP_SEND_SEGMENT    *zc_head;
+    BSP_SEND_SEGMENT    *zc_tail;
+    struct bsp_socket_orphan_t
+                        *next;
+} BSP_SOCKET_ORPHAN;
+#endif
+
+// Segment should be sent by MSG_ZEROCOPY
+#define _ZC_SEGMENT(sck, seg)           (sck->zerocopy_threshold > 0 && \
+                                         BSP_SEGMENT_FILE != seg->type && \
+                                         seg->len - seg->sent >= sck->zerocopy_threshold)
+
 BSP_PRIVATE(BSP_MEMPOOL *) mp_client = NULL;
 BSP_PRIVATE(BSP_MEMPOOL *) mp_connector = NULL;
+BSP_PRIVATE(BSP_MEMPOOL *) mp_segment = NULL;
 BSP_PRIVATE(const char *) _tag_ = "Socket";
+BSP_PRIVATE(pthread_key_t) udp_key;
+BSP_PRIVATE(pthread_once_t) udp_key_once = PTHREAD_ONCE_INIT;
+#ifdef _SOCKET_ZEROCOPY
+BSP_PRIVATE(pthread_key_t) orphan_key;
+BSP_PRIVATE(pthread_once_t) orphan_key_once = PTHREAD_ONCE_INIT;
+#endif
 
 // Initialization : Create mempool
 BSP_DECLARE(int) bsp_socket_init()
 {
     mp_client = bsp_new_mempool(sizeof(BSP_SOCKET_CLIENT), NULL, NULL);
     mp_connector = bsp_new_mempool(sizeof(BSP_SOCKET_CONNECTOR), NULL, NULL);
+    mp_segment = bsp_new_mempool(sizeof(BSP_SEND_SEGMENT), NULL, NULL);
 
-    if (!mp_client || !mp_connector)
+    if (!mp_client || !mp_connector || !mp_segment)
     {
         bsp_trace_message(BSP_TRACE_ALERT, _tag_, "Create mempool failed");
 
@@ -119,6 +200,764 @@ BSP_PRIVATE(void) _maximize_socket_buffer(const int fd)
     return;
 }
 
+/* Datagram */
+// Probe UDP_SEGMENT and turn on UDP_GRO of server socket
+BSP_PRIVATE(void) _enable_udp_offload(BSP_SOCKET *sck)
+{
+    sck->udp_gso = BSP_FALSE;
+    sck->udp_gro = BSP_FALSE;
+#ifdef _SOCKET_UDP_OFFLOAD
+    int flag = 0;
+    // Segment size 0 means per-send cmsg, rejected by kernels without GSO
+    if (0 == setsockopt(sck->fd, SOL_UDP, UDP_SEGMENT, (void *) &flag, sizeof(flag)))
+    {
+        sck->udp_gso = BSP_TRUE;
+    }
+
+    flag = 1;
+    if (0 == setsockopt(sck->fd, SOL_UDP, UDP_GRO, (void *) &flag, sizeof(flag)))
+    {
+        sck->udp_gro = BSP_TRUE;
+    }
+
+    bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "UDP socket %d GSO %s, GRO %s", sck->fd, sck->udp_gso ? "on" : "off", sck->udp_gro ? "on" : "off");
+#endif
+
+    return;
+}
+
+BSP_PRIVATE(void) _udp_ring_destroy(void *arg)
+{
+    BSP_UDP_RING *ring = (BSP_UDP_RING *) arg;
+    if (ring)
+    {
+        bsp_free(ring->in_slots);
+        bsp_free(ring->out_slots);
+        bsp_free(ring);
+    }
+
+    return;
+}
+
+BSP_PRIVATE(void) _udp_key_create()
+{
+    pthread_key_create(&udp_key, _udp_ring_destroy);
+
+    return;
+}
+
+#ifdef _SOCKET_ZEROCOPY
+BSP_PRIVATE(void) _orphan_list_destroy(void *arg)
+{
+    BSP_SOCKET_ORPHAN *o = (BSP_SOCKET_ORPHAN *) arg, *next;
+    while (o)
+    {
+        // Thread exits, pinned segments are left alone as kernel may still use them
+        next = o->next;
+        close(o->fd);
+        bsp_free(o);
+        o = next;
+    }
+
+    return;
+}
+
+BSP_PRIVATE(void) _orphan_key_create()
+{
+    pthread_key_create(&orphan_key, _orphan_list_destroy);
+
+    return;
+}
+#endif
+
+// Ring of current thread, slots mapped once, pages touched only by data
+BSP_PRIVATE(BSP_UDP_RING *) _get_udp_ring()
+{
+    pthread_once(&udp_key_once, _udp_key_create);
+    BSP_UDP_RING *ring = (BSP_UDP_RING *) pthread_getspecific(udp_key);
+    int i;
+    if (!ring)
+    {
+        ring = bsp_calloc(1, sizeof(BSP_UDP_RING));
+        if (!ring)
+        {
+            return NULL;
+        }
+
+        ring->in_slots = bsp_malloc(_BSP_UDP_BATCH * _BSP_UDP_SLOT_SIZE);
+        ring->out_slots = bsp_malloc(_BSP_UDP_BATCH * _BSP_UDP_SLOT_SIZE);
+        if (!ring->in_slots || !ring->out_slots)
+        {
+            bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Create datagram ring failed");
+            _udp_ring_destroy(ring);
+
+            return NULL;
+        }
+
+        for (i = 0; i < _BSP_UDP_BATCH; i ++)
+        {
+            ring->in_iovs[i].iov_base = ring->in_slots + i * _BSP_UDP_SLOT_SIZE;
+            ring->in_msgs[i].msg_hdr.msg_iov = &ring->in_iovs[i];
+            ring->in_msgs[i].msg_hdr.msg_iovlen = 1;
+            ring->in_msgs[i].msg_hdr.msg_name = &ring->in_addrs[i];
+#ifdef _SOCKET_UDP_OFFLOAD
+            ring->in_msgs[i].msg_hdr.msg_control = ring->in_ctls[i].buf;
+#endif
+            ring->out_iovs[i].iov_base = ring->out_slots + i * _BSP_UDP_SLOT_SIZE;
+            ring->out_msgs[i].msg_hdr.msg_iov = &ring->out_iovs[i];
+            ring->out_msgs[i].msg_hdr.msg_iovlen = 1;
+            ring->out_msgs[i].msg_hdr.msg_name = &ring->out_addrs[i];
+        }
+
+        pthread_setspecific(udp_key, ring);
+    }
+
+    return ring;
+}
+
+BSP_PRIVATE(int) _recv_datagrams(int fd, struct mmsghdr *msgs, int n)
+{
+#ifdef OS_LINUX
+    return recvmmsg(fd, msgs, n, 0, NULL);
+#else
+    int i;
+    ssize_t ret;
+    for (i = 0; i < n; i ++)
+    {
+        ret = recvmsg(fd, &msgs[i].msg_hdr, 0);
+        if (ret < 0)
+        {
+            break;
+        }
+
+        msgs[i].msg_len = ret;
+    }
+
+    return (i > 0) ? i : -1;
+#endif
+}
+
+BSP_PRIVATE(int) _send_datagrams(int fd, struct mmsghdr *msgs, int n)
+{
+#ifdef OS_LINUX
+    return sendmmsg(fd, msgs, n, 0);
+#else
+    int i;
+    for (i = 0; i < n; i ++)
+    {
+        if (sendmsg(fd, &msgs[i].msg_hdr, 0) < 0)
+        {
+            break;
+        }
+    }
+
+    return (i > 0) ? i : -1;
+#endif
+}
+
+// Segment size of a GRO coalesced receive, 0 for a plain datagram
+BSP_PRIVATE(size_t) _udp_gro_size(struct msghdr *hdr)
+{
+    size_t seg_size = 0;
+#ifdef _SOCKET_UDP_OFFLOAD
+    struct cmsghdr *cm;
+    int gso_size;
+    for (cm = CMSG_FIRSTHDR(hdr); cm; cm = CMSG_NXTHDR(hdr, cm))
+    {
+        if (SOL_UDP == cm->cmsg_level && UDP_GRO == cm->cmsg_type)
+        {
+            memcpy(&gso_size, CMSG_DATA(cm), sizeof(int));
+            seg_size = (gso_size > 0) ? (size_t) gso_size : 0;
+            break;
+        }
+    }
+#endif
+
+    return seg_size;
+}
+
+// Pack queued datagrams [start, end) of one socket into wire messages
+BSP_PRIVATE(size_t) _pack_datagrams(BSP_UDP_RING *ring, size_t start, size_t end, BSP_BOOLEAN gso)
+{
+    size_t nwire = 0, i = start, j, seg_size, total;
+    struct msghdr *hdr;
+    while (i < end)
+    {
+        j = i + 1;
+        seg_size = ring->out_iovs[i].iov_len;
+        total = seg_size;
+        if (gso && seg_size > 0)
+        {
+            // Same peer, same size, only the last one may be shorter
+            while (j < end && 
+                   j - i < _BSP_UDP_GSO_SEGMENTS && 
+                   ring->out_iovs[j - 1].iov_len == seg_size && 
+                   ring->out_iovs[j].iov_len > 0 && 
+                   ring->out_iovs[j].iov_len <= seg_size && 
+                   total + ring->out_iovs[j].iov_len <= _BSP_UDP_GSO_BYTES && 
+                   ring->out_msgs[j].msg_hdr.msg_namelen == ring->out_msgs[i].msg_hdr.msg_namelen && 
+                   0 == memcmp(&ring->out_addrs[j], &ring->out_addrs[i], ring->out_msgs[i].msg_hdr.msg_namelen))
+            {
+                total += ring->out_iovs[j].iov_len;
+                j ++;
+            }
+        }
+
+        hdr = &ring->wire_msgs[nwire].msg_hdr;
+        memset(hdr, 0, sizeof(struct msghdr));
+        hdr->msg_name = &ring->out_addrs[i];
+        hdr->msg_namelen = ring->out_msgs[i].msg_hdr.msg_namelen;
+        hdr->msg_iov = &ring->out_iovs[i];
+        hdr->msg_iovlen = j - i;
+#ifdef _SOCKET_UDP_OFFLOAD
+        if (j - i > 1)
+        {
+            uint16_t gso_size = (uint16_t) seg_size;
+            struct cmsghdr *cm;
+            memset(&ring->wire_ctls[nwire], 0, sizeof(BSP_UDP_CMSG));
+            hdr->msg_control = ring->wire_ctls[nwire].buf;
+            hdr->msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+            cm = CMSG_FIRSTHDR(hdr);
+            cm->cmsg_level = SOL_UDP;
+            cm->cmsg_type = UDP_SEGMENT;
+            cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            memcpy(CMSG_DATA(cm), &gso_size, sizeof(uint16_t));
+        }
+#endif
+        ring->wire_count[nwire ++] = j - i;
+        i = j;
+    }
+
+    return nwire;
+}
+
+// Receive datagrams in batches until kernel queue drained
+BSP_PRIVATE(size_t) _try_read_datagrams(BSP_SOCKET *sck)
+{
+    BSP_SOCKET_SERVER *srv = (BSP_SOCKET_SERVER *) sck->ptr;
+    BSP_UDP_RING *ring = _get_udp_ring();
+    BSP_THREAD *me = bsp_self_thread();
+    struct mmsghdr *m;
+    const char *data;
+    size_t remain, seg_size, piece;
+    size_t total = 0;
+    int i, n;
+    if (!ring)
+    {
+        return 0;
+    }
+
+    while (BSP_TRUE)
+    {
+        for (i = 0; i < _BSP_UDP_BATCH; i ++)
+        {
+            m = &ring->in_msgs[i];
+            m->msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+            m->msg_hdr.msg_flags = 0;
+#ifdef _SOCKET_UDP_OFFLOAD
+            m->msg_hdr.msg_controllen = sizeof(BSP_UDP_CMSG);
+#endif
+            ring->in_iovs[i].iov_len = _BSP_UDP_SLOT_SIZE;
+        }
+
+        n = _recv_datagrams(sck->fd, ring->in_msgs, _BSP_UDP_BATCH);
+        if (n <= 0)
+        {
+            if (n < 0 && EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno)
+            {
+                bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Receive datagram from socket %d failed", sck->fd);
+            }
+
+            break;
+        }
+
+        for (i = 0; i < n; i ++)
+        {
+            m = &ring->in_msgs[i];
+            if (m->msg_hdr.msg_flags & MSG_TRUNC)
+            {
+                bsp_trace_message(BSP_TRACE_WARNING, _tag_, "Datagram larger than %d bytes dropped", _BSP_UDP_SLOT_SIZE);
+                continue;
+            }
+
+            if (!srv || !srv->on_datagram)
+            {
+                continue;
+            }
+
+            // Coalesced by GRO, split into datagrams of segment size (last one may be shorter)
+            data = (const char *) ring->in_iovs[i].iov_base;
+            remain = m->msg_len;
+            seg_size = _udp_gro_size(&m->msg_hdr);
+            if (0 == seg_size || seg_size > remain)
+            {
+                seg_size = remain;
+            }
+
+            do
+            {
+                piece = (remain < seg_size) ? remain : seg_size;
+                srv->on_datagram(sck, (const struct sockaddr *) m->msg_hdr.msg_name, m->msg_hdr.msg_namelen, data, piece);
+                data += piece;
+                remain -= piece;
+            } while (remain > 0);
+        }
+
+        total += n;
+        if (me && me->arena)
+        {
+            bsp_reset_arena(me->arena);
+        }
+
+        // Replies of this batch go out together
+        bsp_socket_flush_datagrams();
+        if (n < _BSP_UDP_BATCH)
+        {
+            // Drained
+            break;
+        }
+    }
+
+    bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Received %llu datagrams from socket %d", (unsigned long long int) total, sck->fd);
+
+    return total;
+}
+
+/* Send chain */
+// Stop watching pipe of file segment
+BSP_PRIVATE(void) _unwatch_pipe(BSP_SEND_SEGMENT *seg)
+{
+    if (BSP_TRUE == seg->pipe_wait)
+    {
+        bsp_del_event(seg->file);
+        bsp_unreg_fd(seg->file);
+        seg->pipe_wait = BSP_FALSE;
+    }
+
+    return;
+}
+
+BSP_PRIVATE(void) _free_send_segment(BSP_SEND_SEGMENT *seg)
+{
+    _unwatch_pipe(seg);
+    if (BSP_SEGMENT_SHARED == seg->type && seg->release)
+    {
+        seg->release(seg->owner);
+    }
+    else if (BSP_SEGMENT_FILE == seg->type && seg->auto_close)
+    {
+        close(seg->file);
+    }
+
+    bsp_mempool_free(mp_segment, seg);
+
+    return;
+}
+
+BSP_PRIVATE(void) _clear_send_chain(BSP_SOCKET *sck)
+{
+    BSP_SEND_SEGMENT *seg = sck->send_head, *next;
+    while (seg)
+    {
+        next = seg->next;
+        _free_send_segment(seg);
+        seg = next;
+    }
+
+    sck->send_head = sck->send_tail = NULL;
+    sck->send_queued = sck->send_passed = 0;
+    // Pinned segments were handed to orphan list, kernel may still read them
+    sck->zc_head = sck->zc_tail = NULL;
+    sck->zc_seq = sck->zc_done = 0;
+
+    return;
+}
+
+#ifdef _SOCKET_ZEROCOPY
+// Read completions from error queue, done moves to the first incomplete sequence
+BSP_PRIVATE(BSP_BOOLEAN) _drain_zerocopy(int fd, uint32_t *done, BSP_BOOLEAN *copied)
+{
+    char control[128];
+    struct msghdr msg;
+    struct cmsghdr *cm;
+    struct sock_extended_err *serr;
+    BSP_BOOLEAN only_completion = BSP_TRUE;
+    while (BSP_TRUE)
+    {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE) < 0)
+        {
+            // Queue drained
+            break;
+        }
+
+        for (cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (!((SOL_IP == cm->cmsg_level && IP_RECVERR == cm->cmsg_type) || 
+                  (SOL_IPV6 == cm->cmsg_level && IPV6_RECVERR == cm->cmsg_type)))
+            {
+                continue;
+            }
+
+            serr = (struct sock_extended_err *) CMSG_DATA(cm);
+            if (SO_EE_ORIGIN_ZEROCOPY != serr->ee_origin || 0 != serr->ee_errno)
+            {
+                only_completion = BSP_FALSE;
+                continue;
+            }
+
+            // Range [ee_info, ee_data] completed, TCP completes in order
+            *done = serr->ee_data + 1;
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                *copied = BSP_TRUE;
+            }
+        }
+    }
+
+    return only_completion;
+}
+
+// Release pinned segments below done, or all of them
+BSP_PRIVATE(void) _release_zerocopy(BSP_SEND_SEGMENT **head, BSP_SEND_SEGMENT **tail, uint32_t done, BSP_BOOLEAN all)
+{
+    BSP_SEND_SEGMENT *seg;
+    while ((seg = *head) && (all || (int32_t) (seg->zc_seq - done) < 0))
+    {
+        *head = seg->next;
+        if (!*head)
+        {
+            *tail = NULL;
+        }
+
+        _free_send_segment(seg);
+    }
+
+    return;
+}
+
+// Reap orphans of current thread, returns number still pinned
+BSP_PRIVATE(size_t) _reap_orphans()
+{
+    pthread_once(&orphan_key_once, _orphan_key_create);
+    BSP_SOCKET_ORPHAN *head = (BSP_SOCKET_ORPHAN *) pthread_getspecific(orphan_key);
+    BSP_SOCKET_ORPHAN *o = head, *prev = NULL, *next;
+    BSP_BOOLEAN copied = BSP_FALSE;
+    size_t remain = 0;
+    int err = 0;
+    socklen_t errlen = sizeof(err);
+    while (o)
+    {
+        next = o->next;
+        _drain_zerocopy(o->fd, &o->zc_done, &copied);
+        err = 0;
+        if (0 != getsockopt(o->fd, SOL_SOCKET, SO_ERROR, &err, &errlen) || 0 != err)
+        {
+            // Connection aborted, kernel dropped its queue and references
+            _release_zerocopy(&o->zc_head, &o->zc_tail, o->zc_done, BSP_TRUE);
+        }
+        else
+        {
+            _release_zerocopy(&o->zc_head, &o->zc_tail, o->zc_done, BSP_FALSE);
+        }
+
+        if (o->zc_head)
+        {
+            remain ++;
+            prev = o;
+        }
+        else
+        {
+            bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Zero copy sends of closed socket %d completed", o->fd);
+            close(o->fd);
+            if (prev)
+            {
+                prev->next = next;
+            }
+            else
+            {
+                head = next;
+            }
+
+            bsp_free(o);
+        }
+
+        o = next;
+    }
+
+    pthread_setspecific(orphan_key, head);
+
+    return remain;
+}
+
+/*
+ * Kernel may still transmit from pinned pages after close, hand socket and its
+ * pinned segments to orphan list of current thread. Returns BSP_FALSE if
+ * nothing pinned, then socket can be closed now
+ */
+BSP_PRIVATE(BSP_BOOLEAN) _orphan_socket(BSP_SOCKET *sck)
+{
+    if (!sck->zc_head)
+    {
+        return BSP_FALSE;
+    }
+
+    bsp_socket_zerocopy_complete(sck);
+    if (!sck->zc_head)
+    {
+        return BSP_FALSE;
+    }
+
+    BSP_SOCKET_ORPHAN *o = bsp_calloc(1, sizeof(BSP_SOCKET_ORPHAN));
+    if (!o)
+    {
+        // Pages leak instead of being reused under kernel
+        bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Orphan socket %d failed, pinned segments dropped", sck->fd);
+        sck->zc_head = sck->zc_tail = NULL;
+
+        return BSP_FALSE;
+    }
+
+    pthread_once(&orphan_key_once, _orphan_key_create);
+    o->fd = sck->fd;
+    o->zc_done = sck->zc_done;
+    o->zc_head = sck->zc_head;
+    o->zc_tail = sck->zc_tail;
+    o->next = (BSP_SOCKET_ORPHAN *) pthread_getspecific(orphan_key);
+    pthread_setspecific(orphan_key, o);
+    sck->zc_head = sck->zc_tail = NULL;
+
+    // Queued data still goes out before FIN, fd stays open for error queue
+    shutdown(o->fd, SHUT_RDWR);
+    bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Socket %d closed with zero copy sends in flight, orphaned", o->fd);
+
+    return BSP_TRUE;
+}
+#endif
+
+BSP_PRIVATE(BSP_SEND_SEGMENT *) _queue_send_segment(BSP_SOCKET *sck, BSP_SEND_SEGMENT_TYPE type, const char *data, size_t len)
+{
+    BSP_SEND_SEGMENT *seg = bsp_mempool_alloc(mp_segment);
+    if (!seg)
+    {
+        bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Create send segment failed");
+
+        return NULL;
+    }
+
+    seg->type = type;
+    seg->data = data;
+    seg->len = len;
+    seg->sent = 0;
+    seg->mark = sck->send_queued;
+    seg->release = NULL;
+    seg->owner = NULL;
+    seg->file = -1;
+    seg->offset = 0;
+    seg->is_pipe = BSP_FALSE;
+    seg->pipe_wait = BSP_FALSE;
+    seg->auto_close = BSP_FALSE;
+    seg->zc_pinned = BSP_FALSE;
+    seg->zc_seq = 0;
+    seg->next = NULL;
+    if (sck->send_tail)
+    {
+        sck->send_tail->next = seg;
+    }
+    else
+    {
+        sck->send_head = seg;
+    }
+
+    sck->send_tail = seg;
+
+    return seg;
+}
+
+// Gather send buffer spans and segments in stream order
+BSP_PRIVATE(int) _gather_send_chain(BSP_SOCKET *sck, struct iovec *iov, int max)
+{
+    int niov = 0;
+    BSP_BUFFER *buff = &sck->send_buffer;
+    BSP_SEND_SEGMENT *seg = sck->send_head;
+    uint64_t pos = sck->send_passed, end;
+    while (niov < max)
+    {
+        end = seg ? seg->mark : sck->send_queued;
+        if (end > pos)
+        {
+            // Buffered data before next segment
+            iov[niov].iov_base = B_CURR(buff) + (pos - sck->send_passed);
+            iov[niov].iov_len = end - pos;
+            niov ++;
+            pos = end;
+        }
+        else if (seg && BSP_SEGMENT_FILE != seg->type && (0 == niov || !_ZC_SEGMENT(sck, seg)))
+        {
+            iov[niov].iov_base = (void *) (seg->data + seg->sent);
+            iov[niov].iov_len = seg->len - seg->sent;
+            niov ++;
+            seg = seg->next;
+        }
+        else
+        {
+            // File and zero copy segment go by their own syscall
+            break;
+        }
+    }
+
+    return niov;
+}
+
+// Send file segment in kernel
+BSP_PRIVATE(ssize_t) _send_file_segment(BSP_SOCKET *sck, BSP_SEND_SEGMENT *seg)
+{
+    size_t remain = seg->len - seg->sent;
+    off_t offset = seg->offset + seg->sent;
+    ssize_t ret;
+#ifdef OS_LINUX
+    struct pollfd pfd;
+    BSP_FD *f, *pf;
+    if (seg->is_pipe)
+    {
+        _unwatch_pipe(seg);
+        ret = splice(seg->file, NULL, sck->fd, NULL, remain, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        pfd.fd = seg->file;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (ret < 0 && EAGAIN == errno && 0 == poll(&pfd, 1, 0))
+        {
+            // Pipe empty rather than socket full, no writable edge will come, wait for pipe instead
+            f = bsp_get_fd(sck->fd, BSP_FD_ANY);
+            pf = (f && f->event.container) ? bsp_reg_fd(seg->file, BSP_FD_PIPE, sck) : NULL;
+            if (pf)
+            {
+                pf->event.events = BSP_EVENT_READ;
+                pf->event.container = f->event.container;
+                seg->pipe_wait = BSP_TRUE;
+                bsp_set_event(seg->file);
+                bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Pipe %d queued to socket %d empty, wait for it", seg->file, sck->fd);
+            }
+
+            errno = EAGAIN;
+        }
+    }
+    else
+    {
+        ret = sendfile(sck->fd, seg->file, &offset, remain);
+    }
+#else
+    // Copy through stack
+    char chunk[_BSP_SEND_FILE_CHUNK];
+    ret = pread(seg->file, chunk, (remain < _BSP_SEND_FILE_CHUNK) ? remain : _BSP_SEND_FILE_CHUNK, offset);
+    if (ret > 0)
+    {
+        ret = write(sck->fd, chunk, ret);
+    }
+#endif
+    if (0 == ret)
+    {
+        // File shorter than queued, stream cannot be continued
+        bsp_trace_message(BSP_TRACE_ERROR, _tag_, "File %d queued to socket %d truncated", seg->file, sck->fd);
+        errno = EIO;
+        ret = -1;
+    }
+
+    return ret;
+}
+
+#ifdef _SOCKET_ZEROCOPY
+// Send segment without copying, pages pinned until completion
+BSP_PRIVATE(ssize_t) _send_zerocopy_segment(BSP_SOCKET *sck, BSP_SEND_SEGMENT *seg)
+{
+    struct iovec iov;
+    struct msghdr msg;
+    ssize_t ret;
+    iov.iov_base = (void *) (seg->data + seg->sent);
+    iov.iov_len = seg->len - seg->sent;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    ret = sendmsg(sck->fd, &msg, MSG_ZEROCOPY);
+    if (ret >= 0)
+    {
+        // Every successful call takes one sequence
+        seg->zc_pinned = BSP_TRUE;
+        seg->zc_seq = sck->zc_seq ++;
+    }
+    else if (ENOBUFS == errno)
+    {
+        // Out of optmem for notifications, copy this time
+        ret = write(sck->fd, iov.iov_base, iov.iov_len);
+    }
+
+    return ret;
+}
+#endif
+
+// Consume sent bytes from send chain, release finished segments
+BSP_PRIVATE(void) _pass_send_chain(BSP_SOCKET *sck, size_t len)
+{
+    BSP_BUFFER *buff = &sck->send_buffer;
+    BSP_SEND_SEGMENT *seg;
+    uint64_t end;
+    size_t n;
+    while (len > 0)
+    {
+        seg = sck->send_head;
+        end = seg ? seg->mark : sck->send_queued;
+        if (end > sck->send_passed)
+        {
+            n = (len < end - sck->send_passed) ? len : (size_t) (end - sck->send_passed);
+            B_PASS(buff, n)
+            sck->send_passed += n;
+        }
+        else if (seg)
+        {
+            n = (len < seg->len - seg->sent) ? len : seg->len - seg->sent;
+            seg->sent += n;
+            if (seg->sent == seg->len)
+            {
+                sck->send_head = seg->next;
+                if (!sck->send_head)
+                {
+                    sck->send_tail = NULL;
+                }
+
+                if (seg->zc_pinned)
+                {
+                    // Pages still referenced by kernel
+                    seg->next = NULL;
+                    if (sck->zc_tail)
+                    {
+                        sck->zc_tail->next = seg;
+                    }
+                    else
+                    {
+                        sck->zc_head = seg;
+                    }
+
+                    sck->zc_tail = seg;
+                }
+                else
+                {
+                    _free_send_segment(seg);
+                }
+            }
+        }
+        else
+        {
+            break;
+        }
+
+        len -= n;
+    }
+
+    return;
+}
+
 /* Socket operations */
 BSP_PRIVATE(void) _try_close_socket(BSP_SOCKET *sck)
 {
@@ -127,10 +966,9 @@ BSP_PRIVATE(void) _try_close_socket(BSP_SOCKET *sck)
         return;
     }
 
-    // Clean buffer
-    // TODO : Maintain buffer, if not too big
-    bsp_free(sck->read_buffer.data);
-    bsp_free(sck->send_buffer.data);
+    // Clean buffer, memory goes to thread cache for next connection
+    bsp_buffer_release(&sck->read_buffer);
+    bsp_buffer_release(&sck->send_buffer);
     bzero(&sck->read_buffer, sizeof(BSP_BUFFER));
     bzero(&sck->send_buffer, sizeof(BSP_BUFFER));
 
@@ -140,6 +978,17 @@ BSP_PRIVATE(void) _try_close_socket(BSP_SOCKET *sck)
     // Clear state
     sck->state = BSP_SOCK_STATE_IDLE;
 
+#ifdef _SOCKET_ZEROCOPY
+    _reap_orphans();
+    if (_orphan_socket(sck))
+    {
+        _clear_send_chain(sck);
+
+        return;
+    }
+#endif
+    _clear_send_chain(sck);
+
     // Avoid for CLOSE_WAIT
     shutdown(sck->fd, SHUT_RDWR);
     close(sck->fd);
@@ -160,7 +1009,7 @@ BSP_PRIVATE(ssize_t) _try_read_socket(BSP_SOCKET *sck)
         bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Read socket %d failed", sck->fd);
         sck->state |= BSP_SOCK_STATE_PRECLOSE;
     }
-    else if (0 == len)
+    else if (0 == len && !B_FULL((&sck->read_buffer)))
     {
         bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Socket %d FIN", sck->fd);
         sck->state |= BSP_SOCK_STATE_PRECLOSE;
@@ -180,16 +1029,50 @@ BSP_PRIVATE(ssize_t) _try_send_socket(BSP_SOCKET *sck)
         return 0;
     }
 
-    ssize_t len = 0;
-    BSP_BUFFER *buff = &sck->send_buffer;
-    if (B_AVAIL(buff))
+    ssize_t len = 0, total = 0;
+    size_t expect;
+    int i, niov;
+    struct iovec iov[_BSP_SEND_IOV_MAX];
+    BSP_SEND_SEGMENT *seg;
+    while (S_PENDING(sck))
     {
-        len = write(sck->fd, B_CURR(buff), B_AVAIL(buff));
+        seg = sck->send_head;
+        if (seg && BSP_SEGMENT_FILE == seg->type && seg->mark <= sck->send_passed)
+        {
+            expect = seg->len - seg->sent;
+            len = _send_file_segment(sck, seg);
+        }
+#ifdef _SOCKET_ZEROCOPY
+        else if (seg && seg->mark <= sck->send_passed && _ZC_SEGMENT(sck, seg))
+        {
+            expect = seg->len - seg->sent;
+            len = _send_zerocopy_segment(sck, seg);
+        }
+#endif
+        else
+        {
+            niov = _gather_send_chain(sck, iov, _BSP_SEND_IOV_MAX);
+            for (i = 0, expect = 0; i < niov; i ++)
+            {
+                expect += iov[i].iov_len;
+            }
+
+            len = writev(sck->fd, iov, niov);
+        }
+
         if (len < 0)
         {
-            // Send error
-            bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Send socket %d failed", sck->fd);
-            sck->state |= BSP_SOCK_STATE_CLOSE;
+            if (EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno)
+            {
+                // Kernel buffer full, wait for next writable event
+                len = 0;
+            }
+            else
+            {
+                // Send error
+                bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Send socket %d failed", sck->fd);
+                sck->state |= BSP_SOCK_STATE_CLOSE;
+            }
         }
         else if (0 == len)
         {
@@ -205,14 +1088,23 @@ BSP_PRIVATE(ssize_t) _try_send_socket(BSP_SOCKET *sck)
         {
             // Some data written
             bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Send %lld bytes to socket %d", (int64_t) len, sck->fd);
+            _pass_send_chain(sck, len);
+            total += len;
+        }
+
+        if (len <= 0 || (size_t) len < expect)
+        {
+            // Short write, edge triggered event comes again when writable
+            break;
         }
     }
 
-    return len;
+    return (total > 0) ? total : len;
 }
 
 // Create a network server
-BSP_DECLARE(BSP_SOCKET_SERVER *) bsp_new_net_server(const char *addr, uint16_t port, BSP_INET_TYPE inet_type, BSP_SOCK_TYPE sock_type)
+// Create sockets of a network server, with SO_REUSEPORT if reuse_port given
+BSP_PRIVATE(BSP_SOCKET_SERVER *) _new_net_server(const char *addr, uint16_t port, BSP_INET_TYPE inet_type, BSP_SOCK_TYPE sock_type, BSP_BOOLEAN reuse_port)
 {
     int fd, ret, flag;
     int nfds = 0;
@@ -299,6 +1191,9 @@ BSP_DECLARE(BSP_SOCKET_SERVER *) bsp_new_net_server(const char *addr, uint16_t p
         return NULL;
     }
 
+    // Bound read buffer of clients, send buffer is unlimited by default
+    srv->read_buffer_limit = _BSP_SOCKET_READ_BUFFER_LIMIT;
+    srv->accept_budget = _BSP_SOCKET_ACCEPT_BUDGET;
     for (next = ai; next; next = next->ai_next)
     {
         if (nfds >= BSP_MAX_SERVER_SOCKETS)
@@ -373,7 +1268,8 @@ BSP_DECLARE(BSP_SOCKET_SERVER *) bsp_new_net_server(const char *addr, uint16_t p
                     if (0 != setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, (void *) &flag, sizeof(flag)) || 
                         0 != setsockopt(fd, SOL_SOCKET, SO_LINGER, (void *) &ling, sizeof(ling)) ||
                         0 != setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (void *) &flag, sizeof(flag)) || 
-                        0 != setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (void *) &flag, sizeof(flag)))
+                        0 != setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (void *) &flag, sizeof(flag)) || 
+                        (reuse_port && 0 != setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (void *) &flag, sizeof(flag))))
                     {
                         bsp_trace_message(BSP_TRACE_ERROR, _tag_, "SetSockOpt failed");
                         close(fd);
@@ -405,7 +1301,8 @@ BSP_DECLARE(BSP_SOCKET_SERVER *) bsp_new_net_server(const char *addr, uint16_t p
                 // UDP (There was no other socket type of SOCK_DGRAM except UDP now)
                 bsp_trace_message(BSP_TRACE_INFORMATIONAL, _tag_, "Try to create UDP server on %s:%d", ipaddr, port);
                 flag = 1; 
-                if (0 != setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (void *) &flag, sizeof(flag)))
+                if (0 != setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (void *) &flag, sizeof(flag)) || 
+                    (reuse_port && 0 != setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (void *) &flag, sizeof(flag))))
                 {
                     bsp_trace_message(BSP_TRACE_ERROR, _tag_, "SetSockOpt failed");
                     close(fd);
@@ -423,35 +1320,163 @@ BSP_DECLARE(BSP_SOCKET_SERVER *) bsp_new_net_server(const char *addr, uint16_t p
                     continue;
                 }
 
-                bsp_trace_message(BSP_TRACE_NOTICE, _tag_, "UDP server created on %s:%d", ipaddr, port);
-                sock_type = BSP_SOCK_UDP;
-                break;
-            case SOCK_SEQPACKET : 
-                // SCTP (1 -> n)
-                // TODO : SCTP
-                sock_type = BSP_SOCK_SCTP_TO_MANY;
-                break;
-            default : 
-                // Unsupported sock type
-                close(fd);
-                continue;
-                break;
+                bsp_trace_message(BSP_TRACE_NOTICE, _tag_, "UDP server created on %s:%d", ipaddr, port);
+                sock_type = BSP_SOCK_UDP;
+                break;
+            case SOCK_SEQPACKET : 
+                // SCTP (1 -> n)
+                // TODO : SCTP
+                sock_type = BSP_SOCK_SCTP_TO_MANY;
+                break;
+            default : 
+                // Unsupported sock type
+                close(fd);
+                continue;
+                break;
+        }
+
+        srv->scks[nfds].fd = fd;
+        srv->scks[nfds].fd_type = fd_type;
+        srv->scks[nfds].inet_type = inet_type;
+        srv->scks[nfds].sock_type = sock_type;
+        memcpy(&srv->scks[nfds].saddr, (const void *) next->ai_addr, next->ai_addrlen);
+        memcpy(&srv->scks[nfds].addr, next, sizeof(struct addrinfo));
+        srv->scks[nfds].addr.ai_addr = (struct sockaddr *) &srv->scks[nfds].saddr;
+        srv->scks[nfds].ptr = (void *) srv;
+        if (BSP_SOCK_UDP == sock_type)
+        {
+            _enable_udp_offload(&srv->scks[nfds]);
+        }
+
+        nfds ++;
+        bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Register fd %d as a socket server", fd);
+    }
+
+    freeaddrinfo(ai);
+    srv->nscks = nfds;
+    srv->reuse_port = reuse_port;
+
+    return srv;
+}
+
+// Create a network server
+BSP_DECLARE(BSP_SOCKET_SERVER *) bsp_new_net_server(const char *addr, uint16_t port, BSP_INET_TYPE inet_type, BSP_SOCK_TYPE sock_type)
+{
+    return _new_net_server(addr, port, inet_type, sock_type, BSP_FALSE);
+}
+
+// Steer new connections of a reuseport group to the listener indexed by current CPU
+BSP_PRIVATE(void) _steer_by_cpu(int fd, uint32_t nthreads)
+{
+#ifdef _SOCKET_REUSEPORT_CBPF
+    // Listener index = CPU % threads, never out of group
+    struct sock_filter code[] = {
+        {BPF_LD | BPF_W | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_CPU}, 
+        {BPF_ALU | BPF_MOD | BPF_K, 0, 0, nthreads}, 
+        {BPF_RET | BPF_A, 0, 0, 0}
+    };
+    struct sock_fprog prog = {3, code};
+    if (0 != setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, (void *) &prog, sizeof(prog)))
+    {
+        bsp_trace_message(BSP_TRACE_WARNING, _tag_, "Attach CPU steering program to socket %d failed", fd);
+    }
+#else
+    bsp_trace_message(BSP_TRACE_WARNING, _tag_, "CPU steering not supported");
+#endif
+
+    return;
+}
+
+// Create a network server listened by every IO thread
+BSP_DECLARE(BSP_SOCKET_SERVER *) bsp_new_reuseport_server(const char *addr, uint16_t port, BSP_INET_TYPE inet_type, BSP_SOCK_TYPE sock_type, BSP_BOOLEAN steer_by_cpu)
+{
+    BSP_SOCKET_SERVER *srv = NULL, *copy = NULL;
+    BSP_SOCKET *sck;
+    BSP_THREAD *t;
+    BSP_FD *f;
+    BSP_EVENT_SPEC *ev;
+    size_t i, per_thread = 0;
+    int idx;
+    if (!bsp_get_thread(BSP_THREAD_IO, 0))
+    {
+        bsp_trace_message(BSP_TRACE_ERROR, _tag_, "No IO thread to own reuseport listeners");
+
+        return NULL;
+    }
+
+    // One group of listeners for each IO thread, bound in thread order
+    for (idx = 0; NULL != (t = bsp_get_thread(BSP_THREAD_IO, idx)); idx ++)
+    {
+        copy = _new_net_server(addr, port, inet_type, sock_type, BSP_TRUE);
+        if (!copy || 0 == copy->nscks || (srv && (copy->nscks != per_thread || srv->nscks + per_thread > BSP_MAX_SERVER_SOCKETS)))
+        {
+            bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Create reuseport listeners for IO thread %d failed", idx);
+            if (copy)
+            {
+                for (i = 0; i < copy->nscks; i ++)
+                {
+                    close(copy->scks[i].fd);
+                }
+
+                bsp_free(copy);
+            }
+
+            break;
+        }
+
+        if (!srv)
+        {
+            srv = copy;
+            per_thread = copy->nscks;
+        }
+        else
+        {
+            for (i = 0; i < copy->nscks; i ++)
+            {
+                sck = &srv->scks[srv->nscks ++];
+                memcpy(sck, &copy->scks[i], sizeof(BSP_SOCKET));
+                sck->addr.ai_addr = (struct sockaddr *) &sck->saddr;
+                sck->ptr = (void *) srv;
+            }
+
+            bsp_free(copy);
+        }
+
+        // Listeners driven by their own IO thread, accepted clients stay there
+        for (i = srv->nscks - per_thread; i < srv->nscks; i ++)
+        {
+            sck = &srv->scks[i];
+            f = bsp_reg_fd(sck->fd, sck->fd_type, (void *) sck);
+            if (f)
+            {
+                ev = FD_EVENT(f);
+                ev->events = (BSP_SOCK_UDP == sck->sock_type) ? BSP_EVENT_READ : BSP_EVENT_ACCEPT;
+                ev->container = t->event_container;
+                bsp_set_event(sck->fd);
+            }
+        }
+    }
+
+    if (!srv)
+    {
+        return NULL;
+    }
+
+    if (steer_by_cpu)
+    {
+        // Index of a listener in its reuseport group is the index of its IO thread, pinned to CPU of same index
+        for (idx = 0; NULL != (t = bsp_get_thread(BSP_THREAD_IO, idx)); idx ++)
+        {
+            bsp_thread_bind_cpu(t, idx);
         }
 
-        srv->scks[nfds].fd = fd;
-        srv->scks[nfds].fd_type = fd_type;
-        srv->scks[nfds].inet_type = inet_type;
-        srv->scks[nfds].sock_type = sock_type;
-        memcpy(&srv->scks[nfds].saddr, (const void *) next->ai_addr, next->ai_addrlen);
-        memcpy(&srv->scks[nfds].addr, next, sizeof(struct addrinfo));
-        srv->scks[nfds].addr.ai_addr = (struct sockaddr *) &srv->scks[nfds].saddr;
-        srv->scks[nfds].ptr = (void *) srv;
-        nfds ++;
-        bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Register fd %d as a socket server", fd);
+        for (i = 0; i < per_thread; i ++)
+        {
+            _steer_by_cpu(srv->scks[i].fd, (uint32_t) (srv->nscks / per_thread));
+        }
     }
 
-    freeaddrinfo(ai);
-    srv->nscks = nfds;
+    bsp_trace_message(BSP_TRACE_NOTICE, _tag_, "Reuseport server on port %d listened by %d IO threads", port, (int) (srv->nscks / per_thread));
 
     return srv;
 }
@@ -778,7 +1803,11 @@ BSP_DECLARE(BSP_SOCKET_CLIENT *) bsp_new_client(BSP_SOCKET *sck)
         {
             case BSP_SOCK_TCP : 
                 // Do accept
+#ifdef OS_LINUX
+                client_fd = accept4(sck->fd, (struct sockaddr *) &clt->sck.saddr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
                 client_fd = accept(sck->fd, (struct sockaddr *) &clt->sck.saddr, &len);
+#endif
                 if (-1 == client_fd)
                 {
                     bsp_mempool_free(mp_client, clt);
@@ -795,7 +1824,9 @@ BSP_DECLARE(BSP_SOCKET_CLIENT *) bsp_new_client(BSP_SOCKET *sck)
                     return NULL;
                 }
 
+#ifndef OS_LINUX
                 bsp_set_blocking(client_fd, BSP_FD_NONBLOCK);
+#endif
                 clt->sck.fd = client_fd;
                 clt->sck.fd_type = BSP_FD_SOCKET_CLIENT_TCP;
                 if (BSP_INET_IPV6 == sck->inet_type)
@@ -832,10 +1863,26 @@ BSP_DECLARE(BSP_SOCKET_CLIENT *) bsp_new_client(BSP_SOCKET *sck)
         clt->sck.ptr = (void *) clt;
         bsp_clear_buffer(&clt->sck.read_buffer);
         bsp_clear_buffer(&clt->sck.send_buffer);
+        clt->sck.send_head = clt->sck.send_tail = NULL;
+        clt->sck.send_queued = clt->sck.send_passed = 0;
+        clt->sck.zerocopy_threshold = 0;
+        clt->sck.zc_seq = clt->sck.zc_done = 0;
+        clt->sck.zc_head = clt->sck.zc_tail = NULL;
         srv = (BSP_SOCKET_SERVER *) sck->ptr;
         if (srv)
         {
             clt->connected_server = srv;
+            bsp_buffer_set_limit(&clt->sck.read_buffer, srv->read_buffer_limit);
+            bsp_buffer_set_limit(&clt->sck.send_buffer, srv->send_buffer_limit);
+#ifdef _SOCKET_ZEROCOPY
+            int flag = 1;
+            if (srv->zerocopy_threshold > 0 && 
+                BSP_SOCK_TCP == clt->sck.sock_type && 
+                0 == setsockopt(clt->sck.fd, SOL_SOCKET, SO_ZEROCOPY, (void *) &flag, sizeof(flag)))
+            {
+                clt->sck.zerocopy_threshold = srv->zerocopy_threshold;
+            }
+#endif
         }
     }
 
@@ -854,6 +1901,118 @@ BSP_DECLARE(int) bsp_del_client(BSP_SOCKET_CLIENT *clt)
     return BSP_RTN_SUCCESS;
 }
 
+// Arm accepted clients, one batch for each target IO thread
+BSP_PRIVATE(void) _hand_off_clients(BSP_SOCKET_CLIENT **clts, BSP_THREAD **targets, size_t n)
+{
+    int fds[_BSP_SOCKET_ACCEPT_BATCH];
+    size_t i, j, nfds;
+    BSP_THREAD *t;
+    BSP_SOCKET_SERVER *srv;
+    for (i = 0; i < n; i ++)
+    {
+        if (!targets[i])
+        {
+            // No IO thread took it, nobody will ever serve or close this connection
+            bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Register client %d failed, dropped", clts[i]->sck.fd);
+            close(clts[i]->sck.fd);
+            bsp_mempool_free(mp_client, clts[i]);
+            clts[i] = NULL;
+            continue;
+        }
+
+        // Before armed, IO thread may close and free client as soon as it has events
+        srv = clts[i]->connected_server;
+        if (srv && srv->on_connect)
+        {
+            srv->on_connect(clts[i]);
+        }
+    }
+
+    for (i = 0; i < n; i ++)
+    {
+        t = targets[i];
+        if (!t)
+        {
+            continue;
+        }
+
+        // Collect all clients of this thread
+        nfds = 0;
+        for (j = i; j < n; j ++)
+        {
+            if (targets[j] == t)
+            {
+                fds[nfds ++] = clts[j]->sck.fd;
+                targets[j] = NULL;
+            }
+        }
+
+        bsp_set_event_batch(t->event_container, fds, nfds);
+    }
+
+    return;
+}
+
+// Accept clients until queue drained or budget used up
+BSP_PRIVATE(void) _try_accept_socket(BSP_SOCKET *sck)
+{
+    BSP_SOCKET_SERVER *srv = (BSP_SOCKET_SERVER *) sck->ptr;
+    BSP_SOCKET_CLIENT *clt;
+    BSP_SOCKET_CLIENT *clts[_BSP_SOCKET_ACCEPT_BATCH];
+    BSP_THREAD *targets[_BSP_SOCKET_ACCEPT_BATCH];
+    BSP_THREAD *t;
+    BSP_FD *new;
+    BSP_EVENT_SPEC *ev;
+    size_t budget = (srv) ? srv->accept_budget : 0;
+    size_t accepted = 0, n = 0;
+    while (0 == budget || accepted < budget)
+    {
+        bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Try to accept a socket client");
+        clt = bsp_new_client(sck);
+        if (!clt)
+        {
+            // Queue empty, wait for next readiness
+            sck->state &= ~(BSP_SOCK_STATE_ACCEPTABLE);
+            break;
+        }
+
+        accepted ++;
+
+        // Add to IO thread, reuseport listener keeps its clients in current thread
+        t = (srv && srv->reuse_port) ? bsp_self_thread() : bsp_select_thread(BSP_THREAD_IO);
+        new = (t) ? bsp_reg_fd(clt->sck.fd, clt->sck.fd_type, clt) : NULL;
+        if (new)
+        {
+            ev = FD_EVENT(new);
+            ev->events = BSP_EVENT_READ;
+            ev->container = t->event_container;
+        }
+        else
+        {
+            t = NULL;
+        }
+
+        clts[n] = clt;
+        targets[n ++] = t;
+        if (n >= _BSP_SOCKET_ACCEPT_BATCH)
+        {
+            _hand_off_clients(clts, targets, n);
+            n = 0;
+        }
+    }
+
+    _hand_off_clients(clts, targets, n);
+    if (sck->state & BSP_SOCK_STATE_ACCEPTABLE)
+    {
+        // Budget used up with connections left in queue, serve other fds first
+        bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Accept budget of socket %d used up", sck->fd);
+        sck->state &= ~(BSP_SOCK_STATE_ACCEPTABLE);
+        bsp_rearm_event(sck->fd);
+    }
+
+    return;
+}
+
 // Proceed IO
 BSP_DECLARE(int) bsp_drive_socket(BSP_SOCKET *sck)
 {
@@ -867,7 +2026,8 @@ BSP_DECLARE(int) bsp_drive_socket(BSP_SOCKET *sck)
     BSP_SOCKET_CLIENT *clt = NULL;
     BSP_SOCKET_CONNECTOR *cnt = NULL;
     BSP_BUFFER *buff;
-    BSP_FD *f = bsp_get_fd(sck->fd, BSP_FD_ANY), *new;
+    BSP_THREAD *me = NULL;
+    BSP_FD *f = bsp_get_fd(sck->fd, BSP_FD_ANY);
     if (!f)
     {
         return 0;
@@ -910,8 +2070,7 @@ BSP_DECLARE(int) bsp_drive_socket(BSP_SOCKET *sck)
     // Preclose (Send first, if data left in send buffer)
     if (sck->state & BSP_SOCK_STATE_PRECLOSE)
     {
-        buff = &sck->send_buffer;
-        if (B_AVAIL(buff) > 0)
+        if (S_PENDING(sck))
         {
             // Some data remaining
             sck->state |= BSP_SOCK_STATE_WRITABLE;
@@ -927,47 +2086,73 @@ BSP_DECLARE(int) bsp_drive_socket(BSP_SOCKET *sck)
     // Try read
     if (sck->state & BSP_SOCK_STATE_READABLE)
     {
-        // Try read
-        len = _try_read_socket(sck);
-        buff = &sck->read_buffer;
-        if (B_AVAIL(buff))
+        if (S_ISSRV(sck) && BSP_SOCK_UDP == sck->sock_type)
         {
-            if (S_ISCLT(sck))
+            // UDP server, datagrams delivered one by one
+            _try_read_datagrams(sck);
+        }
+        else
+        {
+            buff = &sck->read_buffer;
+            do
             {
-                // Client
-                clt = (BSP_SOCKET_CLIENT *) sck->ptr;
-                if (clt)
+                // Try read
+                processed = 0;
+                len = _try_read_socket(sck);
+                if (B_AVAIL(buff))
                 {
-                    srv = clt->connected_server;
-                    if (srv && srv->on_data)
+                    if (S_ISCLT(sck))
+                    {
+                        // Client
+                        clt = (BSP_SOCKET_CLIENT *) sck->ptr;
+                        if (clt)
+                        {
+                            srv = clt->connected_server;
+                            if (srv && srv->on_data)
+                            {
+                                processed = srv->on_data(clt, B_CURR(buff), B_AVAIL(buff));
+                                B_PASS(buff, processed)
+                                me = bsp_self_thread();
+                                if (me && me->arena)
+                                {
+                                    // Everything built in thread arena by handler goes at once
+                                    bsp_reset_arena(me->arena);
+                                }
+                            }
+                            else
+                            {
+                                B_PASSALL(buff)
+                            }
+                        }
+                        else
+                        {
+                            B_PASSALL(buff)
+                        }
+                    }
+                    else if (S_ISCNT(sck))
+                    {
+                        // Connector
+                        cnt = (BSP_SOCKET_CONNECTOR *) sck->ptr;
+                    }
+                    else if (S_ISSRV(sck))
                     {
-                        processed = srv->on_data(clt, B_CURR(buff), B_AVAIL(buff));
-                        B_PASS(buff, processed)
+                        // UDP server
+                        srv = (BSP_SOCKET_SERVER *) sck->ptr;
                     }
                     else
                     {
-                        B_PASSALL(buff)
+                        // Skip
                     }
                 }
-                else
+
+                if (B_FULL(buff) && 0 == B_NOW(buff))
                 {
-                    B_PASSALL(buff)
+                    // Limited buffer filled by an incomplete frame, which can never be processed
+                    bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Read buffer of socket %d overflow", sck->fd);
+                    sck->state |= BSP_SOCK_STATE_PRECLOSE;
+                    break;
                 }
-            }
-            else if (S_ISCNT(sck))
-            {
-                // Connector
-                cnt = (BSP_SOCKET_CONNECTOR *) sck->ptr;
-            }
-            else if (S_ISSRV(sck))
-            {
-                // UDP server
-                srv = (BSP_SOCKET_SERVER *) sck->ptr;
-            }
-            else
-            {
-                // Skip
-            }
+            } while (processed > 0 && B_FULL(buff));    // Reading stopped at limit, data may be left in kernel
         }
 
         sck->state &= ~(BSP_SOCK_STATE_READABLE);
@@ -978,7 +2163,6 @@ BSP_DECLARE(int) bsp_drive_socket(BSP_SOCKET *sck)
     {
         // Try send
         len = _try_send_socket(sck);
-        buff = &sck->send_buffer;
         if (len > 0)
         {
             if (S_ISCLT(sck))
@@ -1001,8 +2185,7 @@ BSP_DECLARE(int) bsp_drive_socket(BSP_SOCKET *sck)
                 // Skip
             }
 
-            B_PASS(buff, len);
-            if (0 == B_AVAIL(buff))
+            if (!S_PENDING(sck))
             {
                 // No data to write
                 bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "All datas in socket %d 's send buffer have been sent", sck->fd);
@@ -1012,45 +2195,20 @@ BSP_DECLARE(int) bsp_drive_socket(BSP_SOCKET *sck)
                 bsp_set_event(sck->fd);
             }
         }
+
+#ifdef EVENT_USE_IO_URING
+        if (S_PENDING(sck))
+        {
+            // Reported write interest was dropped by io_uring poll, ask for next writability
+            bsp_set_event(sck->fd);
+        }
+#endif
     }
 
     // Server accept
     if (sck->state & BSP_SOCK_STATE_ACCEPTABLE)
     {
-        // Try accept
-        while (BSP_TRUE)
-        {
-            bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Try to accept a socket client");
-            clt = bsp_new_client(sck);
-            if (clt)
-            {
-                // Add to IO thread
-                BSP_THREAD *t = bsp_select_thread(BSP_THREAD_IO);
-                if (t)
-                {
-                    new = bsp_reg_fd(clt->sck.fd, clt->sck.fd_type, clt);
-                    if (new)
-                    {
-                        ev = FD_EVENT(new);
-                        ev->events = BSP_EVENT_READ;
-                        ev->container = t->event_container;
-                        bsp_set_event(clt->sck.fd);
-                    }
-                }
-
-                srv = clt->connected_server;
-                if (srv && srv->on_connect)
-                {
-                    srv->on_connect(clt);
-                }
-            }
-            else
-            {
-                sck->state &= ~(BSP_SOCK_STATE_ACCEPTABLE);
-
-                break;
-            }
-        }
+        _try_accept_socket(sck);
     }
 
     // Real close
@@ -1125,12 +2283,253 @@ BSP_DECLARE(size_t) bsp_socket_append(BSP_SOCKET *sck, const char *data, ssize_t
     size_t append = bsp_buffer_append(buff, data, len);
     if (append > 0)
     {
+        sck->send_queued += append;
         bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Append %lld bytes to socket %d", (long long int) append, sck->fd);
     }
 
     return append;
 }
 
+// Queue const data to send chain of socket
+BSP_DECLARE(size_t) bsp_socket_append_const(BSP_SOCKET *sck, const char *data, size_t len)
+{
+    if (!sck || !data || !len)
+    {
+        return 0;
+    }
+
+    return _queue_send_segment(sck, BSP_SEGMENT_CONST, data, len) ? len : 0;
+}
+
+// Queue shared data to send chain of socket
+BSP_DECLARE(size_t) bsp_socket_append_shared(BSP_SOCKET *sck, const char *data, size_t len, void (* release)(void *), void *owner)
+{
+    if (!sck || !data || !len)
+    {
+        return 0;
+    }
+
+    BSP_SEND_SEGMENT *seg = _queue_send_segment(sck, BSP_SEGMENT_SHARED, data, len);
+    if (!seg)
+    {
+        if (release)
+        {
+            // Reference handed over anyway
+            release(owner);
+        }
+
+        return 0;
+    }
+
+    seg->release = release;
+    seg->owner = owner;
+
+    return len;
+}
+
+BSP_PRIVATE(void) _release_slice(void *slice)
+{
+    bsp_unref_slice((BSP_SLICE *) slice);
+
+    return;
+}
+
+// Queue slice to send chain of socket
+BSP_DECLARE(size_t) bsp_socket_append_slice(BSP_SOCKET *sck, BSP_SLICE *slice)
+{
+    if (!sck || !slice)
+    {
+        return 0;
+    }
+
+    return bsp_socket_append_shared(sck, slice->data, slice->len, _release_slice, bsp_ref_slice(slice));
+}
+
+// Queue file region to send chain of socket
+BSP_DECLARE(size_t) bsp_socket_append_file(BSP_SOCKET *sck, int fd, off_t offset, size_t len, BSP_BOOLEAN auto_close)
+{
+    struct stat st;
+    BSP_SEND_SEGMENT *seg = NULL;
+    if (sck && fd >= 0 && 0 == fstat(fd, &st))
+    {
+        if (S_ISREG(st.st_mode) && offset < st.st_size)
+        {
+            if (0 == len || (off_t) len > st.st_size - offset)
+            {
+                len = st.st_size - offset;
+            }
+
+            seg = _queue_send_segment(sck, BSP_SEGMENT_FILE, NULL, len);
+        }
+#ifdef OS_LINUX
+        else if (S_ISFIFO(st.st_mode) && len > 0)
+        {
+            seg = _queue_send_segment(sck, BSP_SEGMENT_FILE, NULL, len);
+            if (seg)
+            {
+                seg->is_pipe = BSP_TRUE;
+            }
+        }
+#endif
+    }
+
+    if (!seg)
+    {
+        bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Cannot queue file %d to socket", fd);
+        if (auto_close && fd >= 0)
+        {
+            close(fd);
+        }
+
+        return 0;
+    }
+
+    seg->file = fd;
+    seg->offset = offset;
+    seg->auto_close = auto_close;
+
+    return len;
+}
+
+// Drain zero copy completions
+BSP_DECLARE(BSP_BOOLEAN) bsp_socket_zerocopy_complete(BSP_SOCKET *sck)
+{
+#ifdef _SOCKET_ZEROCOPY
+    if (!sck || (0 == sck->zerocopy_threshold && !sck->zc_head))
+    {
+        return BSP_FALSE;
+    }
+
+    BSP_BOOLEAN copied = BSP_FALSE;
+    BSP_BOOLEAN only_completion = _drain_zerocopy(sck->fd, &sck->zc_done, &copied);
+    int err = 0;
+    socklen_t errlen = sizeof(err);
+    if (copied && sck->zerocopy_threshold > 0)
+    {
+        // Kernel copied anyway (loopback, NIC without SG), stop pinning
+        bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "Zero copy of socket %d fell back to copy, disabled", sck->fd);
+        sck->zerocopy_threshold = 0;
+    }
+
+    _release_zerocopy(&sck->zc_head, &sck->zc_tail, sck->zc_done, BSP_FALSE);
+    if (0 != getsockopt(sck->fd, SOL_SOCKET, SO_ERROR, &err, &errlen) || 0 != err)
+    {
+        only_completion = BSP_FALSE;
+    }
+
+    return only_completion;
+#else
+    return BSP_FALSE;
+#endif
+}
+
+// Release pages of closed sockets completed by kernel
+BSP_DECLARE(size_t) bsp_socket_reap_orphans()
+{
+#ifdef _SOCKET_ZEROCOPY
+    return _reap_orphans();
+#else
+    return 0;
+#endif
+}
+
+// Queue a datagram
+BSP_DECLARE(int) bsp_socket_send_datagram(BSP_SOCKET *sck, const struct sockaddr *peer, socklen_t peer_len, const char *data, size_t len)
+{
+    if (!sck || !peer || peer_len > sizeof(struct sockaddr_storage) || !data || len > _BSP_UDP_SLOT_SIZE)
+    {
+        return BSP_RTN_INVALID;
+    }
+
+    BSP_UDP_RING *ring = _get_udp_ring();
+    if (!ring)
+    {
+        return BSP_RTN_ERR_MEMORY;
+    }
+
+    if (ring->nout >= _BSP_UDP_BATCH)
+    {
+        bsp_socket_flush_datagrams();
+    }
+
+    size_t idx = ring->nout ++;
+    memcpy(&ring->out_addrs[idx], peer, peer_len);
+    memcpy(ring->out_iovs[idx].iov_base, data, len);
+    ring->out_iovs[idx].iov_len = len;
+    ring->out_msgs[idx].msg_hdr.msg_namelen = peer_len;
+    ring->out_scks[idx] = sck;
+
+    return BSP_RTN_SUCCESS;
+}
+
+// Send queued datagrams, one sendmmsg for each run of the same socket
+BSP_DECLARE(size_t) bsp_socket_flush_datagrams()
+{
+    pthread_once(&udp_key_once, _udp_key_create);
+    BSP_UDP_RING *ring = (BSP_UDP_RING *) pthread_getspecific(udp_key);
+    BSP_SOCKET *sck;
+    BSP_BOOLEAN gso;
+    size_t start = 0, end, pos, nwire, w, sent = 0;
+    int ret;
+    if (!ring || 0 == ring->nout)
+    {
+        return 0;
+    }
+
+    while (start < ring->nout)
+    {
+        sck = ring->out_scks[start];
+        end = start;
+        while (end < ring->nout && ring->out_scks[end] == sck)
+        {
+            end ++;
+        }
+
+        gso = sck->udp_gso;
+        pos = start;
+        nwire = _pack_datagrams(ring, pos, end, gso);
+        w = 0;
+        while (w < nwire)
+        {
+            ret = _send_datagrams(sck->fd, &ring->wire_msgs[w], nwire - w);
+            if (ret <= 0)
+            {
+                if (ret < 0 && EINTR == errno)
+                {
+                    continue;
+                }
+
+                if (ret < 0 && gso && ring->wire_count[w] > 1 && (EIO == errno || EINVAL == errno))
+                {
+                    // Segmentation refused by route / device, send one by one from now on
+                    bsp_trace_message(BSP_TRACE_NOTICE, _tag_, "UDP GSO disabled on socket %d", sck->fd);
+                    sck->udp_gso = gso = BSP_FALSE;
+                    nwire = _pack_datagrams(ring, pos, end, gso);
+                    w = 0;
+                    continue;
+                }
+
+                // Kernel buffer full, datagrams are allowed to be lost
+                bsp_trace_message(BSP_TRACE_DEBUG, _tag_, "%d datagrams to socket %d dropped", (int) (end - pos), sck->fd);
+                break;
+            }
+
+            while (ret -- > 0)
+            {
+                pos += ring->wire_count[w];
+                sent += ring->wire_count[w];
+                w ++;
+            }
+        }
+
+        start = end;
+    }
+
+    ring->nout = 0;
+
+    return sent;
+}
+
 // Flush send buffer (Add WRITE event)
 BSP_DECLARE(void) bsp_socket_flush(BSP_SOCKET *sck)
 {
@@ -125,6 +125,17 @@ typedef enum bsp_socket_callback_e
 #define BSP_CALLBACK_ON_DATA            BSP_CALLBACK_ON_DATA
 } BSP_SOCKET_CALLBACK;
 
+// Send segment type, data copied by bsp_socket_append() stays in send buffer
+typedef enum bsp_send_segment_type_e
+{
+    BSP_SEGMENT_CONST   = 0x1, 
+#define BSP_SEGMENT_CONST               BSP_SEGMENT_CONST
+    BSP_SEGMENT_SHARED  = 0x2, 
+#define BSP_SEGMENT_SHARED              BSP_SEGMENT_SHARED
+    BSP_SEGMENT_FILE    = 0x3
+#define BSP_SEGMENT_FILE                BSP_SEGMENT_FILE
+} BSP_SEND_SEGMENT_TYPE;
+
 #define BSP_MAX_SERVER_SOCKETS          128
 
 /* Macros */
@@ -140,8 +151,35 @@ typedef enum bsp_socket_callback_e
                                          BSP_FD_SOCKET_CONNECTOR_UDP == s->fd_type || \
                                          BSP_FD_SOCKET_CONNECTOR_SCTP == s->fd_type || \
                                          BSP_FD_SOCKET_CONNECTOR_LOCAL == s->fd_type)
+#define S_PENDING(s)                    (B_AVAIL((&s->send_buffer)) > 0 || NULL != s->send_head)
 
 /* Structs */
+// Data referenced (not copied) by send chain, sent in order with send buffer
+typedef struct bsp_send_segment_t
+{
+    BSP_SEND_SEGMENT_TYPE
+                        type;
+    const char          *data;
+    size_t              len;
+    size_t              sent;
+    uint64_t            mark;           // Send buffer stream position this segment follows
+    void                (* release)(void *);
+    void                *owner;
+
+    // File region
+    int                 file;
+    off_t               offset;
+    BSP_BOOLEAN         is_pipe;
+    BSP_BOOLEAN         pipe_wait;      // Pipe watched by container of socket until data comes
+    BSP_BOOLEAN         auto_close;
+
+    // Zero copy, pinned until completion notified
+    BSP_BOOLEAN         zc_pinned;
+    uint32_t            zc_seq;
+    struct bsp_send_segment_t
+                        *next;
+} BSP_SEND_SEGMENT;
+
 typedef struct bsp_socket_t
 {
     // Summaries
@@ -157,6 +195,24 @@ typedef struct bsp_socket_t
     BSP_BUFFER          read_buffer;
     BSP_BUFFER          send_buffer;
 
+    // Send chain
+    BSP_SEND_SEGMENT    *send_head;
+    BSP_SEND_SEGMENT    *send_tail;
+    uint64_t            send_queued;    // Bytes ever appended to send buffer
+    uint64_t            send_passed;    // Bytes of send buffer already sent
+
+    // Zero copy
+    size_t              zerocopy_threshold;
+                                        // Minimum segment sent by MSG_ZEROCOPY, 0 for disabled
+    uint32_t            zc_seq;         // Sequence of next zero copy send
+    uint32_t            zc_done;        // Sequences below are completed
+    BSP_SEND_SEGMENT    *zc_head;       // Sent segments waiting for completion
+    BSP_SEND_SEGMENT    *zc_tail;
+
+    // UDP segmentation offload
+    BSP_BOOLEAN         udp_gso;        // Queued datagrams to one peer sent as one UDP_SEGMENT send
+    BSP_BOOLEAN         udp_gro;        // Coalesced receives split before on_datagram
+
     // State
     int                 state;
 
@@ -178,7 +234,21 @@ struct bsp_socket_server_t
     int                 (* on_disconnect)(BSP_SOCKET_CLIENT *);
     int                 (* on_error)(BSP_SOCKET_CLIENT *);
     size_t              (* on_data)(BSP_SOCKET_CLIENT *, const char *, size_t);
+    void                (* on_datagram)(BSP_SOCKET *, const struct sockaddr *, socklen_t, const char *, size_t);
     void                *additional;
+
+    // Buffer limits of accepted clients, 0 for unlimited
+    size_t              read_buffer_limit;
+    size_t              send_buffer_limit;
+
+    // Segments from this size sent by MSG_ZEROCOPY to TCP clients, 0 for disabled
+    size_t              zerocopy_threshold;
+
+    // Clients accepted for each readiness of listener before other fds served, 0 for unlimited
+    size_t              accept_budget;
+
+    // Listeners owned by IO threads (SO_REUSEPORT), clients stay in the accepting thread
+    BSP_BOOLEAN         reuse_port;
 };
 
 struct bsp_socket_client_t
@@ -221,6 +291,23 @@ BSP_DECLARE(int) bsp_socket_init();
  */
 BSP_DECLARE(BSP_SOCKET_SERVER *) bsp_new_net_server(const char *addr, uint16_t port, BSP_INET_TYPE inet_type, BSP_SOCK_TYPE sock_type);
 
+/**
+ * Create a network server whose listeners are owned by IO threads.
+ * Every IO thread gets its own SO_REUSEPORT sockets registered in its event
+ * container, kernel balances new connections among them, and accepted clients
+ * are driven by the thread which accepted them, no acceptor thread involved.
+ * Must be called after IO threads started (bsp_prepare() in server mode)
+ *
+ * @param string addr Address (Domain or IP) to bind
+ * @param int port Port number to listen
+ * @param int inet_type INET_*
+ * @param int sock_type SOCK_*
+ * @param bool steer_by_cpu Pin IO thread i to CPU i and choose listener of thread (CPU % threads) by a classic BPF program (Linux only)
+ *
+ * @return p BSP_SOCKET_SERVER
+ */
+BSP_DECLARE(BSP_SOCKET_SERVER *) bsp_new_reuseport_server(const char *addr, uint16_t port, BSP_INET_TYPE inet_type, BSP_SOCK_TYPE sock_type, BSP_BOOLEAN steer_by_cpu);
+
 /**
  * Create a new socket server, listened on UNIX local sock pipe
  *
@@ -281,6 +368,99 @@ BSP_DECLARE(int) bsp_drive_socket(BSP_SOCKET *sck);
  */
 BSP_DECLARE(size_t) bsp_socket_append(BSP_SOCKET *sck, const char *data, ssize_t len);
 
+/**
+ * Queue const data to send chain without copying, data must stay untouched
+ * until sent or socket closed
+ *
+ * @param BSP_SOCKET sck Socket to append
+ * @param string data Data to queue
+ * @param size_t len Length of data
+ *
+ * @return size_t Data queued
+ */
+BSP_DECLARE(size_t) bsp_socket_append_const(BSP_SOCKET *sck, const char *data, size_t len);
+
+/**
+ * Queue shared data to send chain without copying. Socket holds one reference
+ * of owner, release will be called with owner after data sent or socket closed
+ *
+ * @param BSP_SOCKET sck Socket to append
+ * @param string data Data to queue
+ * @param size_t len Length of data
+ * @param callable release Drop the reference held by socket
+ * @param p owner Owner of data
+ *
+ * @return size_t Data queued
+ */
+BSP_DECLARE(size_t) bsp_socket_append_shared(BSP_SOCKET *sck, const char *data, size_t len, void (* release)(void *), void *owner);
+
+/**
+ * Queue slice to send chain without copying, socket holds a reference of slice
+ *
+ * @param BSP_SOCKET sck Socket to append
+ * @param BSP_SLICE slice Slice to queue
+ *
+ * @return size_t Data queued
+ */
+BSP_DECLARE(size_t) bsp_socket_append_slice(BSP_SOCKET *sck, BSP_SLICE *slice);
+
+/**
+ * Queue a region of file to send chain, transmitted by sendfile() (splice()
+ * for pipe) in order with other data, without reading it into memory.
+ * When a pipe runs empty, it is watched by the event container of socket until
+ * data comes, so it must not be registered to any container by caller
+ *
+ * @param BSP_SOCKET sck Socket to append
+ * @param int fd Regular file or pipe
+ * @param off_t offset Start of region, ignored by pipe
+ * @param size_t len Length of region, 0 for the rest of regular file
+ * @param BSP_BOOLEAN auto_close Close fd after sent or socket closed
+ *
+ * @return size_t Bytes queued
+ */
+BSP_DECLARE(size_t) bsp_socket_append_file(BSP_SOCKET *sck, int fd, off_t offset, size_t len, BSP_BOOLEAN auto_close);
+
+/**
+ * Drain zero copy completions from error queue of socket, release segments
+ * pinned by them. Called by event loop when socket triggered an error
+ *
+ * @param BSP_SOCKET sck Socket
+ *
+ * @return bool BSP_TRUE if error was nothing but completions
+ */
+BSP_DECLARE(BSP_BOOLEAN) bsp_socket_zerocopy_complete(BSP_SOCKET *sck);
+
+/**
+ * Release pinned segments of sockets closed before their zero copy sends were
+ * completed. Called by event loop of current thread after each round
+ *
+ * @return size_t Number of closed sockets still waiting for completions
+ */
+BSP_DECLARE(size_t) bsp_socket_reap_orphans();
+
+/**
+ * Queue a datagram to outbound queue of current thread, data copied.
+ * Queue is flushed by sendmmsg() when full, after each received batch of IO
+ * thread, or by bsp_socket_flush_datagrams(). Consecutive datagrams of the same
+ * size to one peer go out as a single UDP_SEGMENT send if supported
+ *
+ * @param BSP_SOCKET sck UDP socket
+ * @param sockaddr peer Peer address
+ * @param socklen_t peer_len Length of peer address
+ * @param string data Datagram
+ * @param size_t len Length of datagram
+ *
+ * @return int Status
+ */
+BSP_DECLARE(int) bsp_socket_send_datagram(BSP_SOCKET *sck, const struct sockaddr *peer, socklen_t peer_len, const char *data, size_t len);
+
+/**
+ * Send all datagrams queued by current thread
+ *
+ * @return size_t Datagrams sent
+ */
+BSP_DECLARE(size_t) bsp_socket_flush_datagrams();
+
 /**
  * Flush send buffer, data will be sent after event set
  *
@@ -69,6 +69,54 @@ BSP_DECLARE(int) bsp_object_init()
     return BSP_RTN_SUCCESS;
 }
 
+// Object storage, from arena or mempool / heap
+BSP_PRIVATE(void *) _node_alloc(BSP_OBJECT *obj, BSP_MEMPOOL *mp, size_t size)
+{
+    return (obj->arena) ? bsp_arena_alloc(obj->arena, size) : bsp_mempool_alloc(mp);
+}
+
+BSP_PRIVATE(void) _node_free(BSP_OBJECT *obj, BSP_MEMPOOL *mp, void *node)
+{
+    if (!obj->arena)
+    {
+        bsp_mempool_free(mp, node);
+    }
+
+    return;
+}
+
+BSP_PRIVATE(void *) _storage_calloc(BSP_OBJECT *obj, size_t nmemb, size_t size)
+{
+    return (obj->arena) ? bsp_arena_calloc(obj->arena, nmemb, size) : bsp_calloc(nmemb, size);
+}
+
+BSP_PRIVATE(void *) _storage_realloc(BSP_OBJECT *obj, void *ptr, size_t old_size, size_t size)
+{
+    if (!obj->arena)
+    {
+        return bsp_realloc(ptr, size);
+    }
+
+    // Old block stays in arena until reset
+    void *ret = bsp_arena_alloc(obj->arena, size);
+    if (ret && ptr)
+    {
+        memcpy(ret, ptr, (old_size < size) ? old_size : size);
+    }
+
+    return ret;
+}
+
+BSP_PRIVATE(void) _storage_free(BSP_OBJECT *obj, void *ptr)
+{
+    if (!obj->arena)
+    {
+        bsp_free(ptr);
+    }
+
+    return;
+}
+
 // GEnerate a new object
 BSP_DECLARE(BSP_OBJECT *) bsp_new_object(BSP_OBJECT_TYPE type)
 {
@@ -83,11 +131,31 @@ BSP_DECLARE(BSP_OBJECT *) bsp_new_object(BSP_OBJECT_TYPE type)
     return obj;
 }
 
+// Generate a new object in arena
+BSP_DECLARE(BSP_OBJECT *) bsp_new_object_in(BSP_ARENA *arena, BSP_OBJECT_TYPE type)
+{
+    if (!arena)
+    {
+        return bsp_new_object(type);
+    }
+
+    BSP_OBJECT *obj = bsp_arena_calloc(arena, 1, sizeof(BSP_OBJECT));
+    if (obj)
+    {
+        bsp_spin_init(&obj->lock);
+        obj->type = type;
+        obj->arena = arena;
+    }
+
+    return obj;
+}
+
 // Delete an object
 BSP_DECLARE(void) bsp_del_object(BSP_OBJECT *obj)
 {
-    if (!obj)
+    if (!obj || obj->arena)
     {
+        // Whole tree goes with arena reset
         return;
     }
 
@@ -423,7 +491,7 @@ BSP_PRIVATE(inline struct bsp_hash_item_t *) _find_from_hash_original(struct bsp
 }
 
 // Remove item from hash
-BSP_PRIVATE(inline BSP_BOOLEAN) _remove_from_hash(struct bsp_hash_t *hash, BSP_STRING *key)
+BSP_PRIVATE(inline BSP_BOOLEAN) _remove_from_hash(BSP_OBJECT *obj, struct bsp_hash_t *hash, BSP_STRING *key)
 {
     BSP_BOOLEAN ret = BSP_FALSE;
     struct bsp_hash_item_t *item = _find_from_hash(hash, key);
@@ -450,7 +518,7 @@ BSP_PRIVATE(inline BSP_BOOLEAN) _remove_from_hash(struct bsp_hash_t *hash, BSP_S
         // Delete data
         bsp_del_value(item->value);
         bsp_del_string(item->key);
-        bsp_mempool_free(mp_hash_item, item);
+        _node_free(obj, mp_hash_item, item);
 
         ret = BSP_TRUE;
     }
@@ -459,7 +527,7 @@ BSP_PRIVATE(inline BSP_BOOLEAN) _remove_from_hash(struct bsp_hash_t *hash, BSP_S
 }
 
 // Insert item to hash
-BSP_PRIVATE(inline BSP_BOOLEAN) _insert_to_hash(struct bsp_hash_t *hash, BSP_STRING *key, BSP_VALUE *val)
+BSP_PRIVATE(inline BSP_BOOLEAN) _insert_to_hash(BSP_OBJECT *obj, struct bsp_hash_t *hash, BSP_STRING *key, BSP_VALUE *val)
 {
     BSP_BOOLEAN ret = BSP_FALSE;
     if (hash && hash->hash_table && key && val)
@@ -475,7 +543,12 @@ BSP_PRIVATE(inline BSP_BOOLEAN) _insert_to_hash(struct bsp_hash_t *hash, BSP_STR
         }
         else
         {
-            item = bsp_mempool_alloc(mp_hash_item);
+            item = _node_alloc(obj, mp_hash_item, sizeof(struct bsp_hash_item_t));
+            if (!item)
+            {
+                return BSP_FALSE;
+            }
+
             item->key = key;
             item->value = val;
             // Insert into link
@@ -513,7 +586,7 @@ BSP_PRIVATE(inline BSP_BOOLEAN) _insert_to_hash(struct bsp_hash_t *hash, BSP_STR
 }
 
 // Resize hash table, rebuild hash link
-BSP_PRIVATE(int) _rebuild_hash(struct bsp_hash_t *hash, size_t new_hash_size)
+BSP_PRIVATE(int) _rebuild_hash(BSP_OBJECT *obj, struct bsp_hash_t *hash, size_t new_hash_size)
 {
     if (hash && new_hash_size)
     {
@@ -523,7 +596,7 @@ BSP_PRIVATE(int) _rebuild_hash(struct bsp_hash_t *hash, size_t new_hash_size)
             return BSP_RTN_SUCCESS;
         }
 
-        struct bsp_hash_item_t *new_hash_table = bsp_calloc(new_hash_size, sizeof(struct bsp_hash_item_t));
+        struct bsp_hash_item_t *new_hash_table = _storage_calloc(obj, new_hash_size, sizeof(struct bsp_hash_item_t));
         if (!new_hash_table)
         {
             bsp_trace_message(BSP_TRACE_ALERT, _tag_, "Canot create hash table");
@@ -532,7 +605,7 @@ BSP_PRIVATE(int) _rebuild_hash(struct bsp_hash_t *hash, size_t new_hash_size)
 
         if (hash->hash_table)
         {
-            bsp_free(hash->hash_table);
+            _storage_free(obj, hash->hash_table);
         }
 
         hash->hash_table = new_hash_table;
@@ -582,7 +655,7 @@ BSP_DECLARE(void) bsp_object_set_array(BSP_OBJECT *obj, ssize_t idx, BSP_VALUE *
         if (!array)
         {
             // New array
-            array = bsp_mempool_alloc(mp_array);
+            array = _node_alloc(obj, mp_array, sizeof(struct bsp_array_t));
             if (!array)
             {
                 bsp_spin_unlock(&obj->lock);
@@ -603,11 +676,11 @@ BSP_DECLARE(void) bsp_object_set_array(BSP_OBJECT *obj, ssize_t idx, BSP_VALUE *
         size_t bucket = (idx / _BSP_ARRAY_BUCKET_SIZE);
         size_t seq = (idx % _BSP_ARRAY_BUCKET_SIZE);
         size_t nbuckets = array->nbuckets;
-        if (bucket >= nbuckets);
+        if (bucket >= nbuckets)
         {
             // Enlarge buckets
             nbuckets = 2 << bsp_log2(bucket + 1);
-            BSP_VALUE ***new_list = bsp_realloc(array->items, nbuckets * sizeof(struct BSP_VALUE **));
+            BSP_VALUE ***new_list = _storage_realloc(obj, array->items, array->nbuckets * sizeof(BSP_VALUE **), nbuckets * sizeof(BSP_VALUE **));
             if (!new_list)
             {
                 bsp_spin_unlock(&obj->lock);
@@ -629,7 +702,7 @@ BSP_DECLARE(void) bsp_object_set_array(BSP_OBJECT *obj, ssize_t idx, BSP_VALUE *
         if (!array->items[bucket])
         {
             // New bucket
-            BSP_VALUE **new_bucket = bsp_calloc(_BSP_ARRAY_BUCKET_SIZE, sizeof(BSP_VALUE **));
+            BSP_VALUE **new_bucket = _storage_calloc(obj, _BSP_ARRAY_BUCKET_SIZE, sizeof(BSP_VALUE *));
             if (!new_bucket)
             {
                 bsp_spin_unlock(&obj->lock);
@@ -663,7 +736,7 @@ BSP_DECLARE(void) bsp_object_set_hash(BSP_OBJECT *obj, BSP_STRING *key, BSP_VALU
         if (!hash)
         {
             // Create new hash
-            hash = bsp_mempool_alloc(mp_hash);
+            hash = _node_alloc(obj, mp_hash, sizeof(struct bsp_hash_t));
             if (!hash)
             {
                 bsp_spin_unlock(&obj->lock);
@@ -673,10 +746,10 @@ BSP_DECLARE(void) bsp_object_set_hash(BSP_OBJECT *obj, BSP_STRING *key, BSP_VALU
             }
 
             bzero(hash, sizeof(struct bsp_hash_t));
-            hash->hash_table = bsp_calloc(_BSP_HASH_SIZE_INITIAL, sizeof(struct bsp_hash_item_t));
+            hash->hash_table = _storage_calloc(obj, _BSP_HASH_SIZE_INITIAL, sizeof(struct bsp_hash_item_t));
             if (!hash->hash_table)
             {
-                bsp_mempool_free(mp_hash, hash);
+                _node_free(obj, mp_hash, hash);
                 bsp_spin_unlock(&obj->lock);
                 bsp_trace_message(BSP_TRACE_ALERT, _tag_, "Create hash table failed");
 
@@ -690,21 +763,21 @@ BSP_DECLARE(void) bsp_object_set_hash(BSP_OBJECT *obj, BSP_STRING *key, BSP_VALU
         if (val)
         {
             // Insert to hash
-            if (BSP_TRUE == _insert_to_hash(hash, key, val))
+            if (BSP_TRUE == _insert_to_hash(obj, hash, key, val))
             {
                 // Successfully
                 hash->nitems ++;
                 if (hash->nitems > 4 * hash->hash_size)
                 {
                     // Rehash
-                    _rebuild_hash(hash, hash->hash_size * 16);
+                    _rebuild_hash(obj, hash, hash->hash_size * 16);
                 }
             }
         }
         else
         {
             // Removal
-            if (BSP_TRUE == _remove_from_hash(hash, key))
+            if (BSP_TRUE == _remove_from_hash(obj, hash, key))
             {
                 hash->nitems --;
             }
@@ -110,6 +110,7 @@ typedef struct bsp_object_t
                         node;
     BSP_SPINLOCK        lock;
     BSP_OBJECT_TYPE     type;
+    BSP_ARENA           *arena;
 } BSP_OBJECT;
 
 /* Functions */
@@ -128,7 +129,19 @@ BSP_DECLARE(int) bsp_object_init();
 BSP_DECLARE(BSP_OBJECT *) bsp_new_object(BSP_OBJECT_TYPE type);
 
 /**
- * Delete an object
+ * Generate a new object in arena. All storage of object comes from arena,
+ * and values / keys set to it should be created in the same arena.
+ * Object is released with arena only
+ *
+ * @param BSP_ARENA arena Arena, NULL for mempool
+ * @param BSP_OBJECT_TYPE type Type of object
+ *
+ * @return p BSP_OBJECT
+ */
+BSP_DECLARE(BSP_OBJECT *) bsp_new_object_in(BSP_ARENA *arena, BSP_OBJECT_TYPE type);
+
+/**
+ * Delete an object. Objects in arena are left to arena
  *
  * @param BSP_OBJECT obj Object to delete
  */
@@ -79,7 +79,7 @@ BSP_DECLARE(BSP_STRING *) bsp_new_string(const char *data, ssize_t len)
     if (!str->buf)
     {
         bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Create string buffer failed");
-        bsp_free(str);
+        bsp_mempool_free(mp_string, str);
 
         return NULL;
     }
@@ -91,6 +91,8 @@ BSP_DECLARE(BSP_STRING *) bsp_new_string(const char *data, ssize_t len)
     }
 
     str->compress_type = BSP_COMPRESS_NONE;
+    str->arena = NULL;
+    str->slice = NULL;
 
     return str;
 }
@@ -110,7 +112,7 @@ BSP_DECLARE(BSP_STRING *) bsp_new_const_string(const char *data, ssize_t len)
     if (!str->buf)
     {
         bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Create string buffer failed");
-        bsp_free(str);
+        bsp_mempool_free(mp_string, str);
 
         return NULL;
     }
@@ -122,6 +124,88 @@ BSP_DECLARE(BSP_STRING *) bsp_new_const_string(const char *data, ssize_t len)
     }
 
     str->compress_type = BSP_COMPRESS_NONE;
+    str->arena = NULL;
+    str->slice = NULL;
+
+    return str;
+}
+
+// Generate a string in arena
+BSP_PRIVATE(BSP_STRING *) _new_string_in(BSP_ARENA *arena, const char *data, ssize_t len, BSP_BOOLEAN copy)
+{
+    if (len < 0)
+    {
+        len = data ? strnlen(data, _BSP_MAX_UNSIZED_STRLEN) : 0;
+    }
+
+    BSP_STRING *str = bsp_arena_calloc(arena, 1, sizeof(BSP_STRING));
+    BSP_BUFFER *buf = bsp_arena_calloc(arena, 1, sizeof(BSP_BUFFER));
+    if (!str || !buf)
+    {
+        bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Create string in arena failed");
+
+        return NULL;
+    }
+
+    if (data && copy)
+    {
+        char *dup = bsp_arena_alloc(arena, len);
+        if (!dup)
+        {
+            bsp_trace_message(BSP_TRACE_CRITICAL, _tag_, "Create string data in arena failed");
+
+            return NULL;
+        }
+
+        memcpy(dup, data, len);
+        data = dup;
+    }
+
+    // Arena data never freed by buffer
+    B_DATA(buf) = (char *) data;
+    B_LEN(buf) = data ? len : 0;
+    buf->is_const = BSP_TRUE;
+    str->buf = buf;
+    bsp_spin_init(&str->lock);
+    str->compress_type = BSP_COMPRESS_NONE;
+    str->arena = arena;
+
+    return str;
+}
+
+BSP_DECLARE(BSP_STRING *) bsp_new_string_in(BSP_ARENA *arena, const char *data, ssize_t len)
+{
+    if (!arena)
+    {
+        return bsp_new_string(data, len);
+    }
+
+    return _new_string_in(arena, data, len, BSP_TRUE);
+}
+
+BSP_DECLARE(BSP_STRING *) bsp_new_const_string_in(BSP_ARENA *arena, const char *data, ssize_t len)
+{
+    if (!arena)
+    {
+        return bsp_new_const_string(data, len);
+    }
+
+    return _new_string_in(arena, data, len, BSP_FALSE);
+}
+
+// Generate a string on slice
+BSP_DECLARE(BSP_STRING *) bsp_new_slice_string(BSP_SLICE *slice)
+{
+    if (!slice)
+    {
+        return NULL;
+    }
+
+    BSP_STRING *str = bsp_new_const_string(slice->data, slice->len);
+    if (str)
+    {
+        str->slice = bsp_ref_slice(slice);
+    }
 
     return str;
 }
@@ -129,8 +213,14 @@ BSP_DECLARE(BSP_STRING *) bsp_new_const_string(const char *data, ssize_t len)
 // Delete (free) a string
 BSP_DECLARE(void) bsp_del_string(BSP_STRING *str)
 {
-    if (str)
+    if (str && !str->arena)
     {
+        if (str->slice)
+        {
+            bsp_unref_slice(str->slice);
+            str->slice = NULL;
+        }
+
         bsp_del_buffer(str->buf);
         str->buf = NULL;
         bsp_mempool_free(mp_string, (void *) str);
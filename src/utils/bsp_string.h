@@ -87,6 +87,8 @@ typedef struct bsp_string_t
     BSP_BUFFER          *buf;
     BSP_COMPRESS_TYPE   compress_type;
     BSP_SPINLOCK        lock;
+    BSP_ARENA           *arena;
+    BSP_SLICE           *slice;
 } BSP_STRING;
 
 /* Functions */
@@ -119,7 +121,39 @@ BSP_DECLARE(BSP_STRING *) bsp_new_string(const char *data, ssize_t len);
 BSP_DECLARE(BSP_STRING *) bsp_new_const_string(const char *data, ssize_t len);
 
 /**
- * Delete a string
+ * Generate a new string in arena, data copied into arena.
+ * String in arena is read-only, released with arena only
+ *
+ * @param BSP_ARENA arena Arena, NULL for mempool
+ * @param string data Initialize data
+ * @param ssize_t len Length of data
+ *
+ * @return p BSP_STRING
+ */
+BSP_DECLARE(BSP_STRING *) bsp_new_string_in(BSP_ARENA *arena, const char *data, ssize_t len);
+
+/**
+ * Generate a new const string in arena, data referenced
+ *
+ * @param BSP_ARENA arena Arena, NULL for mempool
+ * @param string data Data reference
+ * @param ssize_t len Length of data
+ *
+ * @return p BSP_STRING
+ */
+BSP_DECLARE(BSP_STRING *) bsp_new_const_string_in(BSP_ARENA *arena, const char *data, ssize_t len);
+
+/**
+ * Generate a const string on slice data, string holds a reference of slice
+ *
+ * @param BSP_SLICE slice Slice
+ *
+ * @return p BSP_STRING
+ */
+BSP_DECLARE(BSP_STRING *) bsp_new_slice_string(BSP_SLICE *slice);
+
+/**
+ * Delete a string. Strings in arena are left to arena
  *
  * @param BSP_STRING str String to delete
  */
@@ -29,7 +29,7 @@
  */
 
 /**
- * Timer with nanosecond precision
+ * Timer with millisecond precision, driven by per-container hierarchical timing wheel
  *
  * @package bsp::blacktail
  * @author Dr.NP <np@bsgroup.org>
@@ -63,6 +63,177 @@ BSP_DECLARE(int) bsp_timer_init()
     return BSP_RTN_SUCCESS;
 }
 
+#define _ROOT_MASK                      (BSP_TIMER_WHEEL_ROOT_SIZE - 1)
+#define _LEVEL_MASK                     (BSP_TIMER_WHEEL_LEVEL_SIZE - 1)
+#define _LEVEL_SHIFT(n)                 (BSP_TIMER_WHEEL_ROOT_BITS + (n) * BSP_TIMER_WHEEL_LEVEL_BITS)
+#define _WHEEL_SPAN                     ((uint64_t) 1 << _LEVEL_SHIFT(BSP_TIMER_WHEEL_LEVELS))
+
+// Monotonic clock in milliseconds
+BSP_PRIVATE(uint64_t) _now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Timespec to ticks, at least 1
+BSP_PRIVATE(uint64_t) _ts_ticks(struct timespec *ts)
+{
+    uint64_t ticks = (uint64_t) ts->tv_sec * 1000 + (ts->tv_nsec + 999999) / 1000000;
+
+    return (ticks > 0) ? ticks : 1;
+}
+
+// Put timer into wheel. Lock must be held
+BSP_PRIVATE(void) _wheel_link(BSP_TIMER_WHEEL *wheel, BSP_TIMER *tmr)
+{
+    uint64_t expire = tmr->expire;
+    uint64_t delta;
+    size_t idx;
+    int level;
+    if (expire < wheel->current)
+    {
+        // Already expired, trigger in next run
+        expire = wheel->current;
+    }
+
+    delta = expire - wheel->current;
+    if (delta < BSP_TIMER_WHEEL_ROOT_SIZE)
+    {
+        idx = expire & _ROOT_MASK;
+        tmr->slot = &wheel->root[idx];
+        wheel->root_map[idx >> 6] |= ((uint64_t) 1 << (idx & 63));
+    }
+    else
+    {
+        if (delta >= _WHEEL_SPAN)
+        {
+            // Too far, park in the last slot and re-link when cascaded
+            expire = wheel->current + _WHEEL_SPAN - 1;
+            delta = _WHEEL_SPAN - 1;
+        }
+
+        for (level = 0; level < BSP_TIMER_WHEEL_LEVELS - 1; level ++)
+        {
+            if (delta < ((uint64_t) 1 << _LEVEL_SHIFT(level + 1)))
+            {
+                break;
+            }
+        }
+
+        idx = (expire >> _LEVEL_SHIFT(level)) & _LEVEL_MASK;
+        tmr->slot = &wheel->levels[level][idx];
+        wheel->level_map[level] |= ((uint64_t) 1 << idx);
+    }
+
+    tmr->prev = NULL;
+    tmr->next = *tmr->slot;
+    if (tmr->next)
+    {
+        tmr->next->prev = tmr;
+    }
+
+    *tmr->slot = tmr;
+    tmr->wheel = wheel;
+    wheel->total ++;
+
+    return;
+}
+
+// Remove timer from wheel, O(1). Lock must be held
+BSP_PRIVATE(void) _wheel_unlink(BSP_TIMER_WHEEL *wheel, BSP_TIMER *tmr)
+{
+    if (!tmr->slot)
+    {
+        return;
+    }
+
+    if (tmr->prev)
+    {
+        tmr->prev->next = tmr->next;
+    }
+    else
+    {
+        *tmr->slot = tmr->next;
+    }
+
+    if (tmr->next)
+    {
+        tmr->next->prev = tmr->prev;
+    }
+
+    // Bitmap bits are cleared lazily when slot found empty
+    tmr->slot = NULL;
+    tmr->prev = NULL;
+    tmr->next = NULL;
+    wheel->total --;
+
+    return;
+}
+
+// Move timers of upper level slot down. Lock must be held
+BSP_PRIVATE(size_t) _wheel_cascade(BSP_TIMER_WHEEL *wheel, int level)
+{
+    size_t idx = (wheel->current >> _LEVEL_SHIFT(level)) & _LEVEL_MASK;
+    BSP_TIMER *list = wheel->levels[level][idx];
+    BSP_TIMER *tmr = NULL;
+    wheel->levels[level][idx] = NULL;
+    wheel->level_map[level] &= ~((uint64_t) 1 << idx);
+    while (list)
+    {
+        tmr = list;
+        list = list->next;
+        tmr->slot = NULL;
+        wheel->total --;
+        _wheel_link(wheel, tmr);
+    }
+
+    return idx;
+}
+
+// Next tick with non-empty root slot in current round, or start of next round
+BSP_PRIVATE(uint64_t) _wheel_next_root(BSP_TIMER_WHEEL *wheel)
+{
+    size_t idx = wheel->current & _ROOT_MASK;
+    size_t word = idx >> 6;
+    uint64_t bits = wheel->root_map[word] & (~((uint64_t) 0) << (idx & 63));
+    while (BSP_TRUE)
+    {
+        if (bits)
+        {
+            return (wheel->current & ~((uint64_t) _ROOT_MASK)) + (word << 6) + __builtin_ctzll(bits);
+        }
+
+        word ++;
+        if (word >= BSP_TIMER_WHEEL_ROOT_SIZE / 64)
+        {
+            break;
+        }
+
+        bits = wheel->root_map[word];
+    }
+
+    return (wheel->current | _ROOT_MASK) + 1;
+}
+
+// Create timing wheel of container
+BSP_PRIVATE(BSP_TIMER_WHEEL *) _new_timer_wheel()
+{
+    BSP_TIMER_WHEEL *wheel = bsp_calloc(1, sizeof(BSP_TIMER_WHEEL));
+    if (!wheel)
+    {
+        bsp_trace_message(BSP_TRACE_ERROR, _tag_, "Create timing wheel error");
+
+        return NULL;
+    }
+
+    wheel->current = _now_ms();
+    bsp_spin_init(&wheel->lock);
+
+    return wheel;
+}
+
 // Create a new timer
 BSP_DECLARE(BSP_TIMER *) bsp_new_timer(
                                        BSP_EVENT_CONTAINER *ec, 
@@ -82,26 +253,21 @@ BSP_DECLARE(BSP_TIMER *) bsp_new_timer(
         return NULL;
     }
 
-    int fd;
-#if defined(EVENT_USE_EPOLL)
-    // Timerfd
-#ifdef TFD_NONBLOCK
-    fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
-#else
-    fd = timerfd_create(CLOCK_REALTIME, 0);
-    bsp_set_blocking(fd, BSP_FD_NONBLOCK);
-#endif
-    if (-1 == fd)
+    if (!ec->timer_wheel)
     {
-        return NULL;
+        BSP_TIMER_WHEEL *empty = NULL;
+        BSP_TIMER_WHEEL *created = _new_timer_wheel();
+        if (!created)
+        {
+            return NULL;
+        }
+
+        if (!__atomic_compare_exchange_n(&ec->timer_wheel, &empty, created, BSP_FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            // Created by another thread
+            bsp_free(created);
+        }
     }
-#elif defined(EVENT_USE_KQUEUE)
-    // TODO : Kqueue timer
-    return NULL;
-#else
-    // TODO : Normal timer
-    return NULL;
-#endif
 
     BSP_TIMER *tmr = bsp_mempool_alloc(mp_timer);
     if (!tmr)
@@ -111,16 +277,8 @@ BSP_DECLARE(BSP_TIMER *) bsp_new_timer(
         return NULL;
     }
 
-    BSP_FD *f = bsp_reg_fd(fd, BSP_FD_TIMER, tmr);
-    if (!f)
-    {
-        bsp_mempool_free(mp_timer, tmr);
-        return NULL;
-    }
-
     bzero(tmr, sizeof(BSP_TIMER));
     tmr->initialized = BSP_FALSE;
-    tmr->fd = fd;
     tmr->spec.it_value.tv_sec = initial->tv_sec;
     tmr->spec.it_value.tv_nsec = initial->tv_nsec;
     tmr->loop = loop;
@@ -138,12 +296,22 @@ BSP_DECLARE(BSP_TIMER *) bsp_new_timer(
             tmr->spec.it_interval.tv_sec = initial->tv_sec;
             tmr->spec.it_interval.tv_nsec = initial->tv_nsec;
         }
+
+        tmr->interval = _ts_ticks(&tmr->spec.it_interval);
     }
 
-    BSP_EVENT_SPEC *ev = FD_EVENT(f);
-    ev->events = BSP_EVENT_TIMER;
-    ev->container = ec;
-    bsp_set_event(fd);
+    BSP_TIMER_WHEEL *wheel = ec->timer_wheel;
+    bsp_spin_lock(&wheel->lock);
+    tmr->expire = _now_ms() + _ts_ticks(&tmr->spec.it_value);
+    _wheel_link(wheel, tmr);
+    bsp_spin_unlock(&wheel->lock);
+
+    // Wait timeout of other thread's container should be recalculated
+    BSP_THREAD *t = bsp_self_thread();
+    if (!t || t->event_container != ec)
+    {
+        bsp_poke_event_container(ec);
+    }
 
     return tmr;
 }
@@ -156,8 +324,24 @@ BSP_DECLARE(int) bsp_del_timer(BSP_TIMER *tmr)
         return BSP_RTN_INVALID;
     }
 
-    bsp_del_event(tmr->fd);
-    bsp_unreg_fd(tmr->fd);
+    // Firing state is owned by wheel lock, loop thread may be triggering it right now
+    BSP_TIMER_WHEEL *wheel = tmr->wheel;
+    if (wheel)
+    {
+        bsp_spin_lock(&wheel->lock);
+        _wheel_unlink(wheel, tmr);
+        if (BSP_TRUE == tmr->firing)
+        {
+            // Freed by trigger after callback returns
+            tmr->deleted = BSP_TRUE;
+            bsp_spin_unlock(&wheel->lock);
+
+            return BSP_RTN_SUCCESS;
+        }
+
+        bsp_spin_unlock(&wheel->lock);
+    }
+
     bsp_mempool_free(mp_timer, tmr);
 
     return BSP_RTN_SUCCESS;
@@ -166,7 +350,7 @@ BSP_DECLARE(int) bsp_del_timer(BSP_TIMER *tmr)
 // Trigger timer callback
 BSP_DECLARE(int) bsp_trigger_timer(BSP_TIMER *tmr)
 {
-    if (!tmr)
+    if (!tmr || !tmr->wheel)
     {
         return BSP_RTN_INVALID;
     }
@@ -182,19 +366,247 @@ BSP_DECLARE(int) bsp_trigger_timer(BSP_TIMER *tmr)
         tmr->loop --;
     }
 
+    BSP_TIMER_WHEEL *wheel = tmr->wheel;
+    BSP_BOOLEAN deleted;
+    bsp_spin_lock(&wheel->lock);
+    tmr->firing = BSP_TRUE;
+    bsp_spin_unlock(&wheel->lock);
     if (tmr->on_timer)
     {
         tmr->on_timer(tmr);
     }
 
-    if (0 == tmr->loop)
+    if (0 == tmr->loop && tmr->on_complete)
+    {
+        bsp_spin_lock(&wheel->lock);
+        deleted = tmr->deleted;
+        bsp_spin_unlock(&wheel->lock);
+        if (BSP_TRUE != deleted)
+        {
+            // Complete
+            tmr->on_complete(tmr);
+        }
+    }
+
+    // Deleted by callback or another thread meanwhile, or finished
+    bsp_spin_lock(&wheel->lock);
+    tmr->firing = BSP_FALSE;
+    if (BSP_TRUE == tmr->deleted || 0 == tmr->loop)
     {
-        // Complete
-        tmr->on_complete(tmr);
+        _wheel_unlink(wheel, tmr);
+        bsp_spin_unlock(&wheel->lock);
+        bsp_mempool_free(mp_timer, tmr);
 
-        // Remove from container
-        bsp_del_timer(tmr);
+        return BSP_RTN_SUCCESS;
     }
 
+    // Next round
+    if (!tmr->slot)
+    {
+        uint64_t now = _now_ms();
+        tmr->expire += tmr->interval;
+        if (tmr->expire <= now)
+        {
+            // Overrun, skip missed rounds as timerfd does
+            tmr->expire += ((now - tmr->expire) / tmr->interval + 1) * tmr->interval;
+        }
+
+        _wheel_link(wheel, tmr);
+    }
+
+    bsp_spin_unlock(&wheel->lock);
+
     return BSP_RTN_SUCCESS;
 }
+
+// Free timing wheel
+BSP_DECLARE(int) bsp_del_timer_wheel(BSP_TIMER_WHEEL *wheel)
+{
+    if (!wheel)
+    {
+        return BSP_RTN_INVALID;
+    }
+
+    BSP_TIMER *tmr = NULL;
+    int i, j;
+    for (i = 0; i < BSP_TIMER_WHEEL_ROOT_SIZE; i ++)
+    {
+        while ((tmr = wheel->root[i]))
+        {
+            wheel->root[i] = tmr->next;
+            bsp_mempool_free(mp_timer, tmr);
+        }
+    }
+
+    for (i = 0; i < BSP_TIMER_WHEEL_LEVELS; i ++)
+    {
+        for (j = 0; j < BSP_TIMER_WHEEL_LEVEL_SIZE; j ++)
+        {
+            while ((tmr = wheel->levels[i][j]))
+            {
+                wheel->levels[i][j] = tmr->next;
+                bsp_mempool_free(mp_timer, tmr);
+            }
+        }
+    }
+
+    bsp_free(wheel);
+
+    return BSP_RTN_SUCCESS;
+}
+
+// Milliseconds to next check
+BSP_DECLARE(int) bsp_timer_timeout(BSP_EVENT_CONTAINER *ec)
+{
+    BSP_TIMER_WHEEL *wheel = (ec) ? ec->timer_wheel : NULL;
+    if (!wheel)
+    {
+        return -1;
+    }
+
+    uint64_t next, tick, block, now;
+    size_t idx, d;
+    int level;
+    bsp_spin_lock(&wheel->lock);
+    if (0 == wheel->total)
+    {
+        bsp_spin_unlock(&wheel->lock);
+
+        return -1;
+    }
+
+    next = _wheel_next_root(wheel);
+    if ((next & _ROOT_MASK) == 0 || !wheel->root[next & _ROOT_MASK])
+    {
+        // Nothing in current round of root. Waking at round end is useless unless
+        // something cascades there, take the earliest occupied slot instead
+        next = UINT64_MAX;
+        for (idx = 0; idx < (wheel->current & _ROOT_MASK); idx ++)
+        {
+            if (wheel->root[idx])
+            {
+                // Behind current, belongs to next round
+                next = (wheel->current | _ROOT_MASK) + 1 + idx;
+
+                break;
+            }
+        }
+
+        for (level = 0; level < BSP_TIMER_WHEEL_LEVELS; level ++)
+        {
+            if (!wheel->level_map[level])
+            {
+                continue;
+            }
+
+            // Current slot cascaded already unless we stand right on its start
+            block = wheel->current >> _LEVEL_SHIFT(level);
+            d = (wheel->current & (((uint64_t) 1 << _LEVEL_SHIFT(level)) - 1)) ? 1 : 0;
+            for (; d <= BSP_TIMER_WHEEL_LEVEL_SIZE; d ++)
+            {
+                idx = (block + d) & _LEVEL_MASK;
+                if (wheel->levels[level][idx])
+                {
+                    break;
+                }
+            }
+
+            if (d > BSP_TIMER_WHEEL_LEVEL_SIZE)
+            {
+                // Stale bits only
+                continue;
+            }
+
+            tick = (block + d) << _LEVEL_SHIFT(level);
+            if (tick < next)
+            {
+                next = tick;
+            }
+        }
+
+        if (UINT64_MAX == next)
+        {
+            next = (wheel->current | _ROOT_MASK) + 1;
+        }
+    }
+
+    bsp_spin_unlock(&wheel->lock);
+    now = _now_ms();
+    if (next <= now)
+    {
+        return 0;
+    }
+
+    return (next - now > INT_MAX) ? INT_MAX : (int) (next - now);
+}
+
+// Trigger all expired timers
+BSP_DECLARE(int) bsp_run_timers(BSP_EVENT_CONTAINER *ec)
+{
+    BSP_TIMER_WHEEL *wheel = (ec) ? ec->timer_wheel : NULL;
+    if (!wheel)
+    {
+        return 0;
+    }
+
+    uint64_t now = _now_ms();
+    uint64_t next;
+    BSP_TIMER *tmr = NULL;
+    size_t idx;
+    int level, fired = 0;
+    bsp_spin_lock(&wheel->lock);
+    while (wheel->current <= now)
+    {
+        if (0 == wheel->total)
+        {
+            wheel->current = now + 1;
+
+            break;
+        }
+
+        idx = wheel->current & _ROOT_MASK;
+        if (0 == idx)
+        {
+            // New round of root, cascade upper levels
+            for (level = 0; level < BSP_TIMER_WHEEL_LEVELS; level ++)
+            {
+                if (0 != _wheel_cascade(wheel, level))
+                {
+                    break;
+                }
+            }
+        }
+
+        while ((tmr = wheel->root[idx]))
+        {
+            _wheel_unlink(wheel, tmr);
+            if (tmr->expire > wheel->current)
+            {
+                // Parked far timer
+                _wheel_link(wheel, tmr);
+
+                continue;
+            }
+
+            // Marked before lock is dropped, bsp_del_timer() from other threads defers freeing
+            tmr->firing = BSP_TRUE;
+            bsp_spin_unlock(&wheel->lock);
+            bsp_trigger_timer(tmr);
+            fired ++;
+            bsp_spin_lock(&wheel->lock);
+        }
+
+        wheel->root_map[idx >> 6] &= ~((uint64_t) 1 << (idx & 63));
+        wheel->current ++;
+        if (wheel->current & _ROOT_MASK)
+        {
+            // Skip empty slots, stop at start of next round for cascading
+            next = _wheel_next_root(wheel);
+            wheel->current = (next > now + 1) ? now + 1 : next;
+        }
+    }
+
+    bsp_spin_unlock(&wheel->lock);
+
+    return fired;
+}
@@ -44,21 +44,48 @@
 /* Headers */
 
 /* Definations */
+// Timing wheel : 1 millisecond per tick, 8 bits root + 4 levels * 6 bits
+#define BSP_TIMER_WHEEL_ROOT_BITS       8
+#define BSP_TIMER_WHEEL_ROOT_SIZE       (1 << BSP_TIMER_WHEEL_ROOT_BITS)
+#define BSP_TIMER_WHEEL_LEVEL_BITS      6
+#define BSP_TIMER_WHEEL_LEVEL_SIZE      (1 << BSP_TIMER_WHEEL_LEVEL_BITS)
+#define BSP_TIMER_WHEEL_LEVELS          4
 
 /* Macros */
 
 /* Structs */
 typedef struct bsp_timer_t
 {
-    int                 fd;
     ssize_t             loop;
     uint64_t            count;
     void                (* on_timer)(struct bsp_timer_t *);
     void                (* on_complete)(struct bsp_timer_t *);
     struct itimerspec   spec;
     BSP_BOOLEAN         initialized;
+
+    // Timing wheel
+    uint64_t            expire;
+    uint64_t            interval;
+    BSP_BOOLEAN         firing;
+    BSP_BOOLEAN         deleted;
+    struct bsp_timer_wheel_t
+                        *wheel;
+    struct bsp_timer_t  **slot;
+    struct bsp_timer_t  *prev;
+    struct bsp_timer_t  *next;
 } BSP_TIMER;
 
+typedef struct bsp_timer_wheel_t
+{
+    uint64_t            current;
+    size_t              total;
+    BSP_SPINLOCK        lock;
+    uint64_t            root_map[BSP_TIMER_WHEEL_ROOT_SIZE / 64];
+    uint64_t            level_map[BSP_TIMER_WHEEL_LEVELS];
+    BSP_TIMER           *root[BSP_TIMER_WHEEL_ROOT_SIZE];
+    BSP_TIMER           *levels[BSP_TIMER_WHEEL_LEVELS][BSP_TIMER_WHEEL_LEVEL_SIZE];
+} BSP_TIMER_WHEEL;
+
 /* Functions */
 /**
  * Initialize timer mempool
@@ -68,7 +95,8 @@ typedef struct bsp_timer_t
 BSP_DECLARE(int) bsp_timer_init();
 
 /**
- * Create a new timer
+ * Create a new timer in container's timing wheel
+ * Timer will be triggered by the thread running the container
  *
  * @param BSP_EVENT_CONTAINER ev Event container
  * @param timespec initial Initval time of timer (From now to trigger time).
@@ -97,4 +125,31 @@ BSP_DECLARE(int) bsp_del_timer(BSP_TIMER *tmr);
  */
 BSP_DECLARE(int) bsp_trigger_timer(BSP_TIMER *tmr);
 
+/**
+ * Free a timing wheel with all timers in it, no callback will be called
+ *
+ * @param BSP_TIMER_WHEEL wheel Wheel to free
+ *
+ * @return int Status
+ */
+BSP_DECLARE(int) bsp_del_timer_wheel(BSP_TIMER_WHEEL *wheel);
+
+/**
+ * Milliseconds from now to next timer check of container
+ *
+ * @param BSP_EVENT_CONTAINER ec Event container
+ *
+ * @return int Timeout, -1 if no timer
+ */
+BSP_DECLARE(int) bsp_timer_timeout(BSP_EVENT_CONTAINER *ec);
+
+/**
+ * Trigger all expired timers of container
+ *
+ * @param BSP_EVENT_CONTAINER ec Event container
+ *
+ * @return int Number of timers triggered
+ */
+BSP_DECLARE(int) bsp_run_timers(BSP_EVENT_CONTAINER *ec);
+
 #endif  /* _UTILS_BSP_TIMER_H */
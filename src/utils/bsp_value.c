@@ -66,6 +66,27 @@ BSP_DECLARE(int) bsp_value_init()
 BSP_DECLARE(BSP_VALUE *) bsp_new_value()
 {
     BSP_VALUE *v = bsp_mempool_alloc(mp_value);
+    if (v)
+    {
+        v->arena = NULL;
+    }
+
+    return v;
+}
+
+// Generate a new value in arena
+BSP_DECLARE(BSP_VALUE *) bsp_new_value_in(BSP_ARENA *arena)
+{
+    if (!arena)
+    {
+        return bsp_new_value();
+    }
+
+    BSP_VALUE *v = bsp_arena_calloc(arena, 1, sizeof(BSP_VALUE));
+    if (v)
+    {
+        v->arena = arena;
+    }
 
     return v;
 }
@@ -73,7 +94,7 @@ BSP_DECLARE(BSP_VALUE *) bsp_new_value()
 // Delete a value
 BSP_DECLARE(void) bsp_del_value(BSP_VALUE *val)
 {
-    if (val)
+    if (val && !val->arena)
     {
         if (BSP_VALUE_STRING == val->type)
         {
@@ -170,6 +170,7 @@ typedef struct bsp_value_t
     union bsp_value_body_u
                         body;
     BSP_VALUE_TYPE      type;
+    BSP_ARENA           *arena;
 } BSP_VALUE;
 
 /* Functions */
@@ -188,7 +189,16 @@ BSP_DECLARE(int) bsp_value_init();
 BSP_DECLARE(BSP_VALUE *) bsp_new_value();
 
 /**
- * Delete a value
+ * Generate a new value in arena, released with arena only
+ *
+ * @param BSP_ARENA arena Arena, NULL for mempool
+ *
+ * @return p BSP_VALUE
+ */
+BSP_DECLARE(BSP_VALUE *) bsp_new_value_in(BSP_ARENA *arena);
+
+/**
+ * Delete a value. Values in arena are left to arena
  *
  * @param BSP_VALUE v Value to delete
  */